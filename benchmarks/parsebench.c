@@ -0,0 +1,156 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file parsebench.c
+ * @brief compares the bulk text parsers against the fscanf path
+ *
+ * @details Generates a text data block like the ones found after 
+ * "data follows", then times reading it back with one fscanf() call per
+ * value (the original LoadArrayData() approach) and with ParseFloats() or
+ * ParseInts() over a mapped file. The results of both are compared bit 
+ * for bit.
+ *
+ * Usage: parsebench [number of values] [scratch file]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ioutils.h"
+
+double Seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/**
+ * @brief writes n random values in a mixture of formats
+ */
+int WriteValues(const char *filename,size_t n,int isFloat)
+{
+    FILE *fp;
+    size_t i;
+    fp = fopen(filename,"w");
+    if (fp == NULL)
+    {
+        return 1;
+    }
+    srand(42);
+    for (i=0;i<n;i++)
+    {
+        if (isFloat)
+        {
+            double v = ((double)rand()/RAND_MAX - 0.5)*1000.0;
+            switch (i % 4)
+            {
+                case 0: fprintf(fp,"%f",v); break;
+                case 1: fprintf(fp,"%g",v*1e-6); break;
+                case 2: fprintf(fp,"%.8g",v); break;
+                case 3: fprintf(fp,"%e",v*1e12); break;
+            }
+        }
+        else
+        {
+            fprintf(fp,"%d",rand() - RAND_MAX/2);
+        }
+        fprintf(fp,(i % 3 == 2) ? "\n" : " ");
+    }
+    fclose(fp);
+    return 0;
+}
+
+int Run(const char *filename,size_t n,int isFloat)
+{
+    FILE *fp;
+    mappedFile mf;
+    void *ref;
+    void *fast;
+    size_t i;
+    size_t pos;
+    size_t count;
+    double t0,t1,t2;
+
+    ref = malloc(n*4);
+    fast = malloc(n*4);
+    if (ref == NULL || fast == NULL || WriteValues(filename,n,isFloat) != 0)
+    {
+        return 1;
+    }
+
+    // original approach
+    t0 = Seconds();
+    fp = fopen(filename,"r");
+    for (i=0;i<n;i++)
+    {
+        if (isFloat)
+        {
+            fscanf(fp,"%f",(float *)ref + i);
+        }
+        else
+        {
+            fscanf(fp,"%d",(int *)ref + i);
+        }
+    }
+    fclose(fp);
+    t1 = Seconds();
+
+    // bulk parser
+    if (MapFile(&mf,filename) != 0)
+    {
+        return 1;
+    }
+    pos = 0;
+    if (isFloat)
+    {
+        count = ParseFloats(mf.data,mf.size,&pos,(float *)fast,n);
+    }
+    else
+    {
+        count = ParseInts(mf.data,mf.size,&pos,(int *)fast,n);
+    }
+    t2 = Seconds();
+
+    printf("%-6s %zu values, %.1f MB\n",isFloat ? "float" : "int",n,mf.size/1e6);
+    printf("  fscanf     : %8.3f s %8.1f MB/s\n",t1-t0,mf.size/1e6/(t1-t0));
+    printf("  bulk parser: %8.3f s %8.1f MB/s (%.1fx)\n",t2-t1,mf.size/1e6/(t2-t1),(t1-t0)/(t2-t1));
+    if (count != n || memcmp(ref,fast,n*4) != 0)
+    {
+        printf("  MISMATCH\n");
+        return 1;
+    }
+    printf("  results identical\n");
+    UnmapFile(&mf);
+    free(ref);
+    free(fast);
+    return 0;
+}
+
+int main(int argc,char **argv)
+{
+    size_t n;
+    const char *filename;
+    int rc;
+    n = (argc > 1) ? (size_t)atol(argv[1]) : 10000000;
+    filename = (argc > 2) ? argv[2] : "parsebench.tmp";
+    rc = Run(filename,n,1);
+    rc |= Run(filename,n,0);
+    remove(filename);
+    return rc;
+}
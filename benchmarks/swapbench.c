@@ -0,0 +1,119 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file swapbench.c
+ * @brief compares the byte swap kernels against a plain be32toh() loop
+ *
+ * @details Times an in place swap of a large array of 32 bit and 64 bit 
+ * words with the loop the reader and writer used before (one be32toh() or
+ * be64toh() per word), and with ByteSwap32() and ByteSwap64(). The results 
+ * are compared bit for bit.
+ *
+ * Usage: swapbench [number of bytes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <endian.h>
+
+#include "byteSwap.h"
+
+double Seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+int Run(size_t nbytes,int width)
+{
+    unsigned char *ref;
+    unsigned char *fast;
+    size_t i;
+    size_t n;
+    double t0,t1,t2;
+
+    n = nbytes/width;
+    ref = (unsigned char *)malloc(n*width);
+    fast = (unsigned char *)malloc(n*width);
+    if (ref == NULL || fast == NULL)
+    {
+        return 1;
+    }
+    srand(42);
+    for (i=0;i<n*width;i++)
+    {
+        ref[i] = (unsigned char)rand();
+    }
+    memcpy(fast,ref,n*width);
+
+    // original approach
+    t0 = Seconds();
+    if (width == 4)
+    {
+        uint32_t *data32 = (uint32_t *)ref;
+        for (i=0;i<n;i++)
+        {
+            data32[i] = be32toh(data32[i]);
+        }
+    }
+    else
+    {
+        uint64_t *data64 = (uint64_t *)ref;
+        for (i=0;i<n;i++)
+        {
+            data64[i] = be64toh(data64[i]);
+        }
+    }
+    t1 = Seconds();
+
+    // swap kernel
+    if (width == 4)
+    {
+        BigToHost32(fast,fast,n);
+    }
+    else
+    {
+        BigToHost64(fast,fast,n);
+    }
+    t2 = Seconds();
+
+    printf("%d bit words, %.1f MB\n",8*width,n*width/1e6);
+    printf("  be%dtoh loop : %8.3f s %8.1f MB/s\n",8*width,t1-t0,n*width/1e6/(t1-t0));
+    printf("  %-11s: %8.3f s %8.1f MB/s (%.1fx)\n",ByteSwapKernelName(),t2-t1,n*width/1e6/(t2-t1),(t1-t0)/(t2-t1));
+    if (memcmp(ref,fast,n*width) != 0)
+    {
+        printf("  MISMATCH\n");
+        return 1;
+    }
+    printf("  results identical\n");
+    free(ref);
+    free(fast);
+    return 0;
+}
+
+int main(int argc,char **argv)
+{
+    size_t nbytes;
+    int rc;
+    nbytes = (argc > 1) ? (size_t)atol(argv[1]) : 256*1024*1024;
+    rc = Run(nbytes,4);
+    rc |= Run(nbytes,8);
+    return rc;
+}
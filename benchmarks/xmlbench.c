@@ -0,0 +1,162 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file xmlbench.c
+ * @brief compares compressed and uncompressed XML output
+ *
+ * @details Writes a regular grid with a smooth scalar and vector field as
+ * an XML ImageData file, uncompressed, with zlib and with LZ4 (if built
+ * with VTK_HAVE_LZ4), and reports the file size and the write throughput
+ * in MB of uncompressed data per second. Compression uses all processors.
+ *
+ * Usage: xmlbench [points per side] [output file]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "vtkXMLWriter.h"
+
+double Seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+int Run(vtkDataFile *file,const char *filename,unsigned char compressor,const char *label,double *rawSize)
+{
+    struct stat st;
+    double t0,t1;
+    int rc;
+
+    file->compressor = compressor;
+    t0 = Seconds();
+    if (VTK_Open(file,(char *)filename) != VTK_SUCCESS)
+    {
+        return 1;
+    }
+    rc = VTK_WriteXML(file);
+    if (VTK_Close(file) != VTK_SUCCESS && rc == VTK_SUCCESS)
+    {
+        rc = VTK_FILE_ERROR;
+    }
+    t1 = Seconds();
+    if (rc != VTK_SUCCESS || stat(filename,&st) != 0)
+    {
+        printf("  %-5s: failed [code %d]\n",label,rc);
+        return 1;
+    }
+    if (*rawSize == 0)
+    {
+        *rawSize = st.st_size;
+    }
+    printf("  %-5s: %10.1f MB %6.1f%% %8.3f s %8.1f MB/s\n",label,st.st_size/1e6,
+           100.0*st.st_size/(*rawSize),t1-t0,(*rawSize)/1e6/(t1-t0));
+    remove(filename);
+    return 0;
+}
+
+int main(int argc,char **argv)
+{
+    vtkDataFile file;
+    structuredPoints sp;
+    vtkData pointdata;
+    vtkData celldata;
+    scalar sd;
+    vector vd;
+    float *s;
+    float *v;
+    const char *filename;
+    double rawSize;
+    size_t n;
+    size_t i,j,k,p;
+    int side;
+    int rc;
+
+    side = (argc > 1) ? atoi(argv[1]) : 192;
+    filename = (argc > 2) ? argv[2] : "xmlbench.vti";
+    n = (size_t)side*side*side;
+
+    s = (float *)malloc(n*sizeof(float));
+    v = (float *)malloc(3*n*sizeof(float));
+    if (s == NULL || v == NULL)
+    {
+        return 1;
+    }
+    // smooth fields, like most simulation output
+    p = 0;
+    for (k=0;k<side;k++)
+    {
+        for (j=0;j<side;j++)
+        {
+            for (i=0;i<side;i++)
+            {
+                s[p] = sinf(0.05f*i)*cosf(0.03f*j) + 0.01f*k;
+                v[3*p] = cosf(0.02f*i);
+                v[3*p+1] = sinf(0.02f*j);
+                v[3*p+2] = 0.5f;
+                p++;
+            }
+        }
+    }
+
+    for (i=0;i<VTK_DIM;i++)
+    {
+        sp.dimensions[i] = side;
+        sp.origin[i] = 0.0f;
+        sp.spacing[i] = 1.0f;
+    }
+    memset(&sd,0,sizeof(scalar));
+    strcpy(sd.name,"s");
+    sd.type = VTK_FLOAT;
+    sd.data = s;
+    memset(&vd,0,sizeof(vector));
+    strcpy(vd.name,"v");
+    vd.type = VTK_FLOAT;
+    vd.data = v;
+    memset(&pointdata,0,sizeof(vtkData));
+    pointdata.numScalars = 1;
+    pointdata.numVectors = 1;
+    pointdata.size = n;
+    pointdata.scalar_data = &sd;
+    pointdata.vector_data = &vd;
+    memset(&celldata,0,sizeof(vtkData));
+
+    memset(&file,0,sizeof(vtkDataFile));
+    file.dataType = VTK_XML;
+    file.geometry = VTK_STRUCTURED_POINTS;
+    file.dataset = &sp;
+    file.pointdata = &pointdata;
+    file.celldata = &celldata;
+    file.numThreads = GetNumProcessors();
+    file.memoryBudget = VTK_MEMORY_BUDGET_DEFAULT;
+
+    printf("%d^3 grid, %.1f MB of point data, %d threads\n",side,16.0*n/1e6,file.numThreads);
+    rawSize = 0;
+    rc = Run(&file,filename,VTK_COMPRESSOR_NONE,"raw",&rawSize);
+    rc |= Run(&file,filename,VTK_COMPRESSOR_ZLIB,"zlib",&rawSize);
+#ifdef VTK_HAVE_LZ4
+    rc |= Run(&file,filename,VTK_COMPRESSOR_LZ4,"lz4",&rawSize);
+#endif
+    free(s);
+    free(v);
+    return rc;
+}
@@ -0,0 +1,253 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "byteSwap.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTESWAP_X86
+#endif
+
+typedef void (*swapKernel)(void *dst, const void *src, size_t n);
+
+/**
+ * @brief scalar 32 bit swap, also used for the tails of the vector kernels
+ */
+static void Swap32Scalar(void *dst, const void *src, size_t n)
+{
+    uint32_t w;
+    size_t i;
+    for (i=0;i<n;i++)
+    {
+        // memcpy keeps unaligned buffers legal, it compiles to a plain load
+        memcpy(&w,(const char *)src + 4*i,4);
+        w = __builtin_bswap32(w);
+        memcpy((char *)dst + 4*i,&w,4);
+    }
+}
+
+/**
+ * @brief scalar 64 bit swap
+ */
+static void Swap64Scalar(void *dst, const void *src, size_t n)
+{
+    uint64_t w;
+    size_t i;
+    for (i=0;i<n;i++)
+    {
+        memcpy(&w,(const char *)src + 8*i,8);
+        w = __builtin_bswap64(w);
+        memcpy((char *)dst + 8*i,&w,8);
+    }
+}
+
+#ifdef BYTESWAP_X86
+/**
+ * @brief SSSE3 kernel, 4 words per shuffle
+ */
+__attribute__((target("ssse3")))
+static void Swap32SSSE3(void *dst, const void *src, size_t n)
+{
+    const __m128i mask = _mm_set_epi8(12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3);
+    const char *s;
+    char *d;
+    size_t i;
+    s = (const char *)src;
+    d = (char *)dst;
+    for (i=0;i+8<=n;i+=8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + 4*i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 4*i + 16));
+        _mm_storeu_si128((__m128i *)(d + 4*i),_mm_shuffle_epi8(a,mask));
+        _mm_storeu_si128((__m128i *)(d + 4*i + 16),_mm_shuffle_epi8(b,mask));
+    }
+    Swap32Scalar(d + 4*i,s + 4*i,n - i);
+}
+
+/**
+ * @brief SSSE3 kernel, 2 words per shuffle
+ */
+__attribute__((target("ssse3")))
+static void Swap64SSSE3(void *dst, const void *src, size_t n)
+{
+    const __m128i mask = _mm_set_epi8(8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7);
+    const char *s;
+    char *d;
+    size_t i;
+    s = (const char *)src;
+    d = (char *)dst;
+    for (i=0;i+4<=n;i+=4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + 8*i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 8*i + 16));
+        _mm_storeu_si128((__m128i *)(d + 8*i),_mm_shuffle_epi8(a,mask));
+        _mm_storeu_si128((__m128i *)(d + 8*i + 16),_mm_shuffle_epi8(b,mask));
+    }
+    Swap64Scalar(d + 8*i,s + 8*i,n - i);
+}
+
+/**
+ * @brief AVX2 kernel, 8 words per shuffle
+ */
+__attribute__((target("avx2")))
+static void Swap32AVX2(void *dst, const void *src, size_t n)
+{
+    const __m256i mask = _mm256_set_epi8(12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3,
+                                         12,13,14,15,8,9,10,11,4,5,6,7,0,1,2,3);
+    const char *s;
+    char *d;
+    size_t i;
+    s = (const char *)src;
+    d = (char *)dst;
+    for (i=0;i+16<=n;i+=16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(s + 4*i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 4*i + 32));
+        _mm256_storeu_si256((__m256i *)(d + 4*i),_mm256_shuffle_epi8(a,mask));
+        _mm256_storeu_si256((__m256i *)(d + 4*i + 32),_mm256_shuffle_epi8(b,mask));
+    }
+    Swap32Scalar(d + 4*i,s + 4*i,n - i);
+}
+
+/**
+ * @brief AVX2 kernel, 4 words per shuffle
+ */
+__attribute__((target("avx2")))
+static void Swap64AVX2(void *dst, const void *src, size_t n)
+{
+    const __m256i mask = _mm256_set_epi8(8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7,
+                                         8,9,10,11,12,13,14,15,0,1,2,3,4,5,6,7);
+    const char *s;
+    char *d;
+    size_t i;
+    s = (const char *)src;
+    d = (char *)dst;
+    for (i=0;i+8<=n;i+=8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(s + 8*i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 8*i + 32));
+        _mm256_storeu_si256((__m256i *)(d + 8*i),_mm256_shuffle_epi8(a,mask));
+        _mm256_storeu_si256((__m256i *)(d + 8*i + 32),_mm256_shuffle_epi8(b,mask));
+    }
+    Swap64Scalar(d + 8*i,s + 8*i,n - i);
+}
+#endif
+
+/**
+ * @brief picks the widest kernel the CPU supports
+ * @param width the word size, 4 or 8 bytes
+ * @param name if not NULL, set to the name of the kernel
+ */
+static swapKernel SelectKernel(int width, const char **name)
+{
+    const char *dummy;
+    if (name == NULL)
+    {
+        name = &dummy;
+    }
+#ifdef BYTESWAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return (width == 4) ? Swap32AVX2 : Swap64AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        *name = "ssse3";
+        return (width == 4) ? Swap32SSSE3 : Swap64SSSE3;
+    }
+#endif
+    *name = "scalar";
+    return (width == 4) ? Swap32Scalar : Swap64Scalar;
+}
+
+/* kernels chosen on first use, a race between threads is harmless as they
+ * all store the same pointer*/
+static swapKernel swap32 = NULL;
+static swapKernel swap64 = NULL;
+
+/**
+ * @brief reverses the byte order of n 32 bit words
+ * @param dst the output words, may be equal to src but must not otherwise
+ * overlap it
+ * @param src the input words
+ * @param n the number of words
+ */
+void ByteSwap32(void *dst, const void *src, size_t n)
+{
+    if (swap32 == NULL)
+    {
+        swap32 = SelectKernel(4,NULL);
+    }
+    swap32(dst,src,n);
+}
+
+/**
+ * @brief reverses the byte order of n 64 bit words
+ * @param dst the output words, may be equal to src but must not otherwise
+ * overlap it
+ * @param src the input words
+ * @param n the number of words
+ */
+void ByteSwap64(void *dst, const void *src, size_t n)
+{
+    if (swap64 == NULL)
+    {
+        swap64 = SelectKernel(8,NULL);
+    }
+    swap64(dst,src,n);
+}
+
+/**
+ * @brief gets the name of the kernel used on this CPU
+ * @returns "avx2", "ssse3" or "scalar"
+ */
+const char * ByteSwapKernelName(void)
+{
+    const char *name;
+    SelectKernel(4,&name);
+    return name;
+}
+
+/**
+ * @brief copies words that are already in the required order
+ */
+static void CopyWords(void *dst, const void *src, size_t nbytes)
+{
+    if (dst != src)
+    {
+        memcpy(dst,src,nbytes);
+    }
+}
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+void HostToBig32(void *dst, const void *src, size_t n) { ByteSwap32(dst,src,n); }
+void HostToBig64(void *dst, const void *src, size_t n) { ByteSwap64(dst,src,n); }
+void BigToHost32(void *dst, const void *src, size_t n) { ByteSwap32(dst,src,n); }
+void BigToHost64(void *dst, const void *src, size_t n) { ByteSwap64(dst,src,n); }
+void LittleToHost32(void *dst, const void *src, size_t n) { CopyWords(dst,src,4*n); }
+void LittleToHost64(void *dst, const void *src, size_t n) { CopyWords(dst,src,8*n); }
+#else
+void HostToBig32(void *dst, const void *src, size_t n) { CopyWords(dst,src,4*n); }
+void HostToBig64(void *dst, const void *src, size_t n) { CopyWords(dst,src,8*n); }
+void BigToHost32(void *dst, const void *src, size_t n) { CopyWords(dst,src,4*n); }
+void BigToHost64(void *dst, const void *src, size_t n) { CopyWords(dst,src,8*n); }
+void LittleToHost32(void *dst, const void *src, size_t n) { ByteSwap32(dst,src,n); }
+void LittleToHost64(void *dst, const void *src, size_t n) { ByteSwap64(dst,src,n); }
+#endif
@@ -0,0 +1,50 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file byteSwap.h
+ * @brief Endian conversion of arrays of 32 and 64 bit words
+ * 
+ * @details Shared by the reader and the writer. On x86 the swaps use AVX2 or
+ * SSSE3 byte shuffles, chosen at run time from the CPU features, otherwise
+ * a scalar loop is used. All functions take separate source and destination
+ * buffers, so a copy and a swap are done in one pass, and dst may equal src
+ * for an in place swap.
+ *
+ * @author David J. Warne (david.warne@qut.edu.au)
+ * @author High Performance Computing and Research Support
+ * @author Queensland University of Technology
+ *
+ */
+#ifndef __BYTESWAP_H
+#define __BYTESWAP_H
+
+#include <stddef.h>
+#include <endian.h>
+
+void ByteSwap32(void *dst, const void *src, size_t n);
+void ByteSwap64(void *dst, const void *src, size_t n);
+const char * ByteSwapKernelName(void);
+
+/* conversions between host order and a fixed byte order, n is the number 
+ * of words. Words already in host order are copied (if dst != src).*/
+void HostToBig32(void *dst, const void *src, size_t n);
+void HostToBig64(void *dst, const void *src, size_t n);
+void BigToHost32(void *dst, const void *src, size_t n);
+void BigToHost64(void *dst, const void *src, size_t n);
+void LittleToHost32(void *dst, const void *src, size_t n);
+void LittleToHost64(void *dst, const void *src, size_t n);
+#endif
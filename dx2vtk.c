@@ -26,526 +26,1715 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "dxFileReader.h"
 #include "vtkFileWriter.h"
+#include "vtkXMLWriter.h"
 
 #include "ioutils.h"
 
+#define USAGE "Usage: dx2vtk [-i] [-j N] [-m MB] [-s] [-z zlib | lz4] filename.dx filename.vtk [ASCII | BINARY | XML]\n" \
+              "  -i  use (and create) a sidecar index filename.dxidx\n" \
+              "  -j  convert and write N series or group members at a time\n" \
+              "  -m  read at most MB MiB of external binary data at a time\n" \
+              "  -s  stream, load each member only while it is converted\n" \
+              "  -z  compress XML output with zlib or lz4\n"
+
+/* cells remapped by each task of a parallel remap*/
+#define CELLS_PER_TASK 65536
+
+typedef struct conversionJob_struct conversionJob;
+typedef struct sharedGeometry_struct sharedGeometry;
+typedef struct remapJob_struct remapJob;
+
+/* a converted dataset, shared by the fields that reference the same 
+ * positions and connections objects*/
+struct sharedGeometry_struct {
+    object *positions;
+    object *connections;
+    unsigned char geometry; // vtk dataset type
+    void *dataset; // owned by the job, borrows the dx arrays
+};
+
+/* dx cubes or quads remapped to vtk cells, one range of cells per task*/
+struct remapJob_struct {
+    const int *in; // dx cell vertices
+    int *out; // vtk cell vertices, may be the same buffer as in
+    const float *points; // positions
+    int numVerts; // 4 or 8
+    size_t numCells;
+    const int *order; // vtk vertex order, as indices of the dx vertices
+    const int *mirrorOrder; // order of left handed cells, NULL if all take order
+    int cellType; // the vtk type of remapped cells
+    int alignedType; // the vtk type of axis aligned cells, kept in dx order
+    int *cellTypes; // output type of each cell, or NULL to keep no voxels or pixels
+};
+
+/* shared state of a parallel conversion, one task per field*/
+struct conversionJob_struct {
+    dxFile *dxf;
+    object **fields; // fields to convert, field i is written to file i
+    const char *pattern; // output filename pattern
+    char type; // VTK_ASCII, VTK_BINARY or VTK_XML
+    int formatThreads; // threads each task may use to remap cells and format output
+    size_t memoryBudget; // bytes of external data each task reads at a time
+    unsigned char compressor; // XML compressor, VTK_COMPRESSOR_NONE if none
+    int stream; // if non-zero, load and release each field around its task
+    sharedGeometry *geometries; // converted datasets, at most one per field
+    int numGeometries;
+    pthread_mutex_t lock; // serialises loading from dxf and the geometries
+    int rc; // first error, DX_SUCCESS if none
+};
+
 
 /**
- * @brief creates a VTK dataset from a OpenDX Field object OpenDX file.
- * @details uses the position and connection OpenDX field components to 
- * construct a VTK dataset mesh.
- * @param field pointer to the field object wrapper
- * @param pointer to the vtkFile structure to load to
- * @returns DX_SUCCESS on completion, or an appropriate error code
+ * @brief finds the positions and connections components of a field
+ * @param fieldObject the field object
+ * @param pos output positions object, NULL if there is none
+ * @param con output connections object, NULL if there is none
  */
-int dxField2VTKDataSet(object *fieldObject, vtkDataFile *vtkFile)
+void GetFieldGeometry(object *fieldObject, object **pos, object **con)
 {
     int i;
-    object * pos;
-    object * con;
     field *fld;
-    
+
     fld = (field *)(fieldObject->obj);
-#ifdef DEBUG
-    printf("Writing Field %d [%s] %hhu\n",fieldObject->number,fieldObject->name,fieldObject->isLoaded);
-    printf("Num Components: %d\n",fld->numComponents);
-#endif
-    
-    // identify the position (geometry) and connections (topology) components
-    // any other components are considered as data
+    *pos = NULL;
+    *con = NULL;
     for (i=0;i<fld->numComponents;i++)
     {
-        object * comp;
-        comp = fld->components[i];
-        if (streq(comp->alias,"positions"))
+        if (streq(fld->aliases[i],"positions"))
         {
-            pos = comp;
+            *pos = fld->components[i];
         }
-        else if (streq(comp->alias,"connections"))
+        else if (streq(fld->aliases[i],"connections"))
         {
-            con = comp;
+            *con = fld->components[i];
         }
-        else 
-        {
-            array * data;
-            attribute *attr;
-            data = (array *)(comp->obj);
-            // test if data depends on positions or connections
-            attr = GetAttribute(comp,"dep");
-            if (attr != NULL)
-            {
-                if (streq(attr->string,"positions"))
-                {
-                
-                    if (data->rank == 0)
-                    {
-                        vtkFile->pointdata->numScalars++;
-                    }
-                    else if (data->rank == 1 && data->shape[0] == 3)
-                    {
-                        vtkFile->pointdata->numVectors++;
-                    }
+    }
+}
 
-                }
-                else if (streq(attr->string,"connections"))
-                {
-                    if (data->rank == 0)
-                    {
-                        vtkFile->celldata->numScalars++;
-                    }
-                    else if ( data->rank == 1 && data->shape[0] == 3)
-                    {
-                        vtkFile->celldata->numVectors++;
-                    }
+/**
+ * @brief gets the counts, origin and deltas of regular grid positions
+ * @details Grid positions and products of regular arrays, one per axis, 
+ * both describe the points of a regular grid, which is kept implicit.
+ * @param pos the positions object
+ * @param grid output, with counts, origin and deltas that hold VTK_DIM, 
+ * VTK_DIM and VTK_DIM*VTK_DIM values
+ * @returns DX_SUCCESS if the positions form a regular grid, otherwise 
+ * DX_NOT_SUPPORTED_ERROR
+ */
+int GetGridPositions(object *pos, gridpositions *grid)
+{
+    int i,j;
+    int n;
 
-                }
-            }
-        }
-    }
-   
-    // dx positions and connections map to a vtk data set type
-    if (pos->class == DX_GRIDPOSITIONS && con->class == DX_GRIDCONNECTIONS)
+    if (pos->class == DX_GRIDPOSITIONS)
     {
-        gridpositions *gp;
-        gridconnections *gc;
-        structuredPoints *spdata;
-        vtkFile->geometry = VTK_STRUCTURED_POINTS;
-
-        gp = (gridpositions *)pos->obj;
-        gc = (gridconnections *)con->obj;
-        
-        spdata = (structuredPoints *)malloc(sizeof(structuredPoints));
-        if (spdata == NULL)
+        gridpositions *gp = (gridpositions *)pos->obj;
+        n = gp->numCounts;
+        if (n > VTK_DIM)
         {
-            return DX_MEMORY_ERROR;
+            return DX_NOT_SUPPORTED_ERROR;
         }
-
-        spdata->dimensions[0] = 1;
-        spdata->dimensions[1] = 1;
-        spdata->dimensions[2] = 1;
-
-        spdata->origin[0] = 0.0;
-        spdata->origin[1] = 0.0;
-        spdata->origin[2] = 0.0;
-
-        spdata->spacing[0] = 1.0;
-        spdata->spacing[1] = 1.0;
-        spdata->spacing[2] = 1.0;
-
-        // gridconnections are really not used
-        if (gp->numCounts > 3)
+        grid->numCounts = n;
+        memcpy(grid->counts,gp->counts,n*sizeof(int));
+        memcpy(grid->origin,gp->origin,n*sizeof(float));
+        memcpy(grid->deltas,gp->deltas,n*n*sizeof(float));
+        return DX_SUCCESS;
+    }
+    else if (pos->class == DX_PRODUCTARRAY)
+    {
+        array *pa = (array *)pos->obj;
+        n = pa->numTerms;
+        if (n > VTK_DIM || pa->type != DX_FLOAT || GetItemSize(pa) != (size_t)n)
         {
             return DX_NOT_SUPPORTED_ERROR;
         }
-
-        for (i=0;i<gp->numCounts;i++)
+        grid->numCounts = n;
+        for (i=0;i<n;i++)
         {
-            spdata->dimensions[i] = gp->counts[gp->numCounts - i -1];
+            grid->origin[i] = 0.0;
         }
-        
-        for (i=0;i<gp->numCounts;i++)
+        for (j=0;j<n;j++)
         {
-            spdata->origin[i] = gp->origin[gp->numCounts - i -1];
+            array *term = (array *)(pa->terms[j]->obj);
+            if (pa->terms[j]->class != DX_REGULARARRAY)
+            {
+                return DX_NOT_SUPPORTED_ERROR;
+            }
+            grid->counts[j] = term->items;
+            for (i=0;i<n;i++)
+            {
+                grid->origin[i] += ((float *)(term->origin))[i];
+                grid->deltas[j*n+i] = ((float *)(term->delta))[i];
+            }
         }
+        return DX_SUCCESS;
+    }
+    return DX_NOT_SUPPORTED_ERROR;
+}
 
-        // @todo we assume that deltas are orthogonal, if not then structured points is
-        // not the best dataset type... but not quite sure which on is the best yet.
-        for (i=0;i<gp->numCounts;i++)
-        {
-            spdata->spacing[i] = gp->deltas[(gp->numCounts - i -1)*(gp->numCounts + 1)];
-        }
-        
-        vtkFile->dataset = spdata;
+/**
+ * @brief gets the values of an OpenDX array as a buffer in memory
+ * @details A loaded buffer is borrowed. An external binary array left on 
+ * disk is read, and an implicit array is expanded, into a buffer of our own.
+ * @param arrayObject the dx array
+ * @param values output pointer to the values
+ * @param ownsValues output, set if values must be freed with the vtk dataset
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxArrayBuffer(object *arrayObject, void **values, unsigned char *ownsValues)
+{
+    array *data_array;
+
+    data_array = (array *)arrayObject->obj;
+    *values = data_array->data;
+    *ownsValues = 0;
+    if (*values != NULL)
+    {
         return DX_SUCCESS;
     }
-    else if (pos->class == DX_ARRAY && con->class == DX_ARRAY)
+    *ownsValues = 1;
+    if (arrayObject->class == DX_ARRAY)
+    {
+        return LoadExternalArrayData(data_array,values);
+    }
+    *values = malloc(GetArraySize(data_array)*GetTypeSize(data_array->type));
+    if (*values == NULL)
     {
-        //  the following is incorrect... shape 3 connections equals polydata
-        //  whereas shape 4 equals Unstructured Grid... to be simple I've just made 
-        //  both map to unstructured grid, but this is not ideal
+        return DX_MEMORY_ERROR;
+    }
+    return DX_ExpandArray(arrayObject,0,data_array->items,*values);
+}
 
-#ifdef DEBUG
-    printf("get here?\n");
-#endif
-        array *pos_array;
-        array *con_array;
-        attribute *attr;
-        unstructuredGrid *ugdata;
-        vtkFile->geometry = VTK_UNSTRUCTURED_GRID;
-        // extract the geometry and topology
-        pos_array = (array *)pos->obj;
-        con_array = (array *)con->obj;
+/**
+ * @brief gets the positions of an OpenDX field as vtk points
+ * @details Points in three dimensions are buffered as by dxArrayBuffer(),
+ * points in two dimensions are copied into a buffer of our own with z = 0.
+ * @param pos the positions object, with 2 or 3 floats per item
+ * @param points output pointer to the points
+ * @param ownsPoints output, set if points must be freed with the vtk dataset
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxPositions2Points(object *pos, float **points, unsigned char *ownsPoints)
+{
+    int rc;
+    size_t i;
+    size_t numPoints;
+    float *xy;
+    unsigned char ownsXY;
 
-        if ((ugdata = (unstructuredGrid *)malloc(sizeof(unstructuredGrid))) == NULL)
+    if (((array *)pos->obj)->shape[0] == 3)
+    {
+        return dxArrayBuffer(pos,(void **)points,ownsPoints);
+    }
+    rc = dxArrayBuffer(pos,(void **)&xy,&ownsXY);
+    if (rc != DX_SUCCESS)
+    {
+        if (ownsXY)
         {
-            return DX_MEMORY_ERROR;
+            free(xy);
         }
-
-        // get the number of positions, this maps to points
-        ugdata->numPoints = pos_array->items;
-        // now the number of cells
-        ugdata->numCells = con_array->items;
-
-        if (pos_array->type != DX_FLOAT || pos_array->rank != 1 || pos_array->shape[0] != 3)
+        return rc;
+    }
+    numPoints = ((array *)pos->obj)->items;
+    *points = (float *)malloc(numPoints*3*sizeof(float));
+    *ownsPoints = 1;
+    if (*points != NULL)
+    {
+        for (i=0;i<numPoints;i++)
         {
-            return DX_INVALID_FILE_ERROR;
+            (*points)[3*i] = xy[2*i];
+            (*points)[3*i+1] = xy[2*i+1];
+            (*points)[3*i+2] = 0.0f;
         }
-        // allocate memory for points
-        ugdata->points = (float *)malloc(3*(ugdata->numPoints)*sizeof(float));
+    }
+    if (ownsXY)
+    {
+        free(xy);
+    }
+    return (*points == NULL) ? DX_MEMORY_ERROR : DX_SUCCESS;
+}
 
-        if (con_array->rank != 1)
-        {
-            return DX_INVALID_FILE_ERROR;
-        }
+/**
+ * @brief creates a rectilinear grid from product positions
+ * @details A product of arrays, one per axis, where the items of each term 
+ * vary only in the component of its own axis, gives the points of a 
+ * rectilinear grid. As for regular grids, the last term is the vtk x axis.
+ * Only the coordinates along each axis are kept.
+ * @param pos the positions object, a product array
+ * @param rgdata output rectilinear grid
+ * @returns DX_SUCCESS on completion, DX_NOT_SUPPORTED_ERROR if the 
+ * positions are not rectilinear, or an appropriate error code
+ */
+int dxProduct2RectilinearGrid(object *pos, rectilinearGrid **rgdata)
+{
+    int i,j,l;
+    int k;
+    int n;
+    int rc;
+    array *pa;
+    rectilinearGrid *rg;
+    float *values[VTK_DIM];
+    unsigned char owns[VTK_DIM];
+    float *coordinates[VTK_DIM];
+    int num[VTK_DIM];
 
-        // allocate memory for cells
-        ugdata->cells = (int *)malloc((con_array->shape[0])*(ugdata->numCells)*sizeof(int));
-        ugdata->numVerts = (int *)malloc((ugdata->numCells)*sizeof(int));
-        ugdata->cellTypes = (int *)malloc((ugdata->numCells)*sizeof(int));
+    pa = (array *)pos->obj;
+    n = pa->numTerms;
+    if (pos->class != DX_PRODUCTARRAY || n > VTK_DIM || pa->type != DX_FLOAT || GetItemSize(pa) != (size_t)n)
+    {
+        return DX_NOT_SUPPORTED_ERROR;
+    }
 
-        if ((ugdata->points == NULL) || (ugdata->cells == NULL) || (ugdata->numVerts == NULL) || (ugdata->cellTypes == NULL))
+    rc = DX_SUCCESS;
+    for (j=0;j<n;j++)
+    {
+        values[j] = NULL;
+        owns[j] = 0;
+    }
+    for (i=0;i<VTK_DIM;i++)
+    {
+        coordinates[i] = NULL;
+        num[i] = 1;
+    }
+    for (j=0;j<n && rc == DX_SUCCESS;j++)
+    {
+        array *term = (array *)(pa->terms[j]->obj);
+        rc = dxArrayBuffer(pa->terms[j],(void **)&(values[j]),&(owns[j]));
+        // each term must move along its own axis only
+        for (k=1;k<(term->items) && rc == DX_SUCCESS;k++)
         {
-            return DX_MEMORY_ERROR;
+            for (l=0;l<n;l++)
+            {
+                if (l != j && values[j][k*n+l] != values[j][l])
+                {
+                    rc = DX_NOT_SUPPORTED_ERROR;
+                }
+            }
         }
+        num[n-1-j] = term->items;
+    }
 
-        // copy the point data arrays
-        memcpy((void*)ugdata->points,pos_array->data,3*(pos_array->items)*sizeof(float));
-        // now the cell data (may need to re-map verts) this depends 
-        // the element type attribute
-        attr = GetAttribute(con,"element type");
-        if (attr == NULL)
+    for (i=0;i<VTK_DIM && rc == DX_SUCCESS;i++)
+    {
+        coordinates[i] = (float *)malloc(num[i]*sizeof(float));
+        if (coordinates[i] == NULL)
         {
-            return DX_INVALID_FILE_ERROR;
+            rc = DX_MEMORY_ERROR;
         }
-
-        // determine the element type required and map accordingly
-        if (streq(attr->string,"lines"))
+        else if (i >= n)
         {
-            for (i=0;i<ugdata->numCells;i++)
-            {
-                ugdata->numVerts[i] = 2;
-                ugdata->cellTypes[i] = VTK_LINE; 
-            }
-            // simple enough
-            memcpy((void*)ugdata->cells,con_array->data,(con_array->shape[0])*(con_array->items)*sizeof(int));
+            coordinates[i][0] = 0.0;
         }
-        else if (streq(attr->string,"triangles"))
+        else
         {
-            for (i=0;i<ugdata->numCells;i++)
+            // the other terms offset the axis by their constant component
+            float offset;
+            j = n-1-i;
+            offset = 0.0;
+            for (l=0;l<n;l++)
             {
-                ugdata->numVerts[i] = 3;
-                ugdata->cellTypes[i] = VTK_TRIANGLE; 
+                offset += (l == j) ? 0.0 : values[l][j];
             }
-            // again simple enough
-            memcpy((void*)ugdata->cells,con_array->data,(con_array->shape[0])*(con_array->items)*sizeof(int));
-        }
-        else if (streq(attr->string,"quads"))
-        {
-            for (i=0;i<ugdata->numCells;i++)
+            for (k=0;k<num[i];k++)
             {
-                ugdata->numVerts[i] = 4;
-                ugdata->cellTypes[i] = VTK_QUAD; 
+                coordinates[i][k] = values[j][k*n+j] + offset;
             }
-            // again simple enough
-            memcpy((void*)ugdata->cells,con_array->data,(con_array->shape[0])*(con_array->items)*sizeof(int));
         }
-        else if (streq(attr->string,"cubes"))
+    }
+
+    for (j=0;j<n;j++)
+    {
+        if (owns[j])
+        {
+            free(values[j]);
+        }
+    }
+    rg = (rectilinearGrid *)malloc(sizeof(rectilinearGrid));
+    if (rc != DX_SUCCESS || rg == NULL)
+    {
+        for (i=0;i<VTK_DIM;i++)
         {
-            return DX_NOT_SUPPORTED_ERROR;
+            free(coordinates[i]);
         }
-        else if (streq(attr->string,"cubes2D"))
+        free(rg);
+        return (rc != DX_SUCCESS) ? rc : DX_MEMORY_ERROR;
+    }
+
+    for (i=0;i<VTK_DIM;i++)
+    {
+        rg->dimensions[i] = num[i];
+    }
+    rg->numX = num[0];
+    rg->numY = num[1];
+    rg->numZ = num[2];
+    rg->X_coordinates = coordinates[0];
+    rg->Y_coordinates = coordinates[1];
+    rg->Z_coordinates = coordinates[2];
+    *rgdata = rg;
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief gets the counts of a regular grid of connections
+ * @details Grid connections hold their counts, a mesh array is a product 
+ * of paths, each joining one more point than it has items.
+ * @param con the connections object
+ * @param counts output counts, holds VTK_DIM values
+ * @param numCounts output number of counts
+ * @returns DX_SUCCESS if the connections form a regular grid, otherwise 
+ * DX_NOT_SUPPORTED_ERROR
+ */
+int GetGridCounts(object *con, int *counts, int *numCounts)
+{
+    int j;
+
+    if (con->class == DX_GRIDCONNECTIONS)
+    {
+        gridconnections *gc = (gridconnections *)con->obj;
+        if (gc->numCounts > VTK_DIM)
         {
             return DX_NOT_SUPPORTED_ERROR;
         }
-        else if (streq(attr->string,"cubesnD"))
+        *numCounts = gc->numCounts;
+        memcpy(counts,gc->counts,gc->numCounts*sizeof(int));
+        return DX_SUCCESS;
+    }
+    else if (con->class == DX_MESHARRAY)
+    {
+        array *ma = (array *)con->obj;
+        if (ma->numTerms > VTK_DIM)
         {
             return DX_NOT_SUPPORTED_ERROR;
         }
-        else if (streq(attr->string,"tetrahedra"))
+        *numCounts = ma->numTerms;
+        for (j=0;j<ma->numTerms;j++)
+        {
+            counts[j] = ((array *)(ma->terms[j]->obj))->items + 1;
+        }
+        return DX_SUCCESS;
+    }
+    return DX_NOT_SUPPORTED_ERROR;
+}
+
+/**
+ * @brief creates a structured grid from positions on grid connections
+ * @details Positions that are not regular, but are connected as a grid,
+ * are the points of a structured grid. The cells follow from the 
+ * dimensions, so no connectivity is built. As for regular grids, the last
+ * dx axis is the vtk x axis, which leaves the points in the same order.
+ * @param pos the positions object
+ * @param con the connections object, grid connections or a mesh array
+ * @param sgdata output structured grid
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxGrid2StructuredGrid(object *pos, object *con, structuredGrid **sgdata)
+{
+    int i;
+    int n;
+    int rc;
+    int counts[VTK_DIM];
+    size_t numPoints;
+    array *pos_array;
+    structuredGrid *sg;
+
+    pos_array = (array *)pos->obj;
+    if (pos_array->type != DX_FLOAT || pos_array->rank != 1 || pos_array->shape[0] != 3)
+    {
+        return DX_NOT_SUPPORTED_ERROR;
+    }
+    if ((rc = GetGridCounts(con,counts,&n)) != DX_SUCCESS)
+    {
+        return rc;
+    }
+    numPoints = 1;
+    for (i=0;i<n;i++)
+    {
+        numPoints *= counts[i];
+    }
+    if (numPoints != (size_t)(pos_array->items))
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+
+    if ((sg = (structuredGrid *)malloc(sizeof(structuredGrid))) == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    for (i=0;i<VTK_DIM;i++)
+    {
+        sg->dimensions[i] = (i < n) ? counts[n-i-1] : 1;
+    }
+    sg->numPoints = pos_array->items;
+    // points are borrowed as for unstructured grids
+    rc = dxArrayBuffer(pos,(void **)&(sg->points),&(sg->ownsPoints));
+    if (rc != DX_SUCCESS)
+    {
+        free(sg);
+        return rc;
+    }
+    *sgdata = sg;
+    return DX_SUCCESS;
+}
+
+/* the vertices of dx cubes and quads are ordered as in a grid, with the
+ * last index fastest. In the usual dx layout z is fastest and x slowest,
+ * and the first order goes around each face of a hexahedron (or around a
+ * quad) as vtk expects. Cells whose edges are left handed, e.g., with x 
+ * fastest, take the mirrored second order.*/
+const int hexahedronOrder[2][8] = {{0,4,6,2,1,5,7,3},{0,1,3,2,4,5,7,6}};
+const int quadOrder[2][4] = {{0,2,3,1},{0,1,3,2}};
+
+/**
+ * @brief gets the vtk voxel or pixel order of an axis aligned dx cell
+ * @details The edges from the first vertex must each run along one 
+ * coordinate axis, in the increasing direction and no two along the same 
+ * axis, and every other vertex must be at the matching corner. The 
+ * directions are worked out for each cell, vtk then orders the corners 
+ * with the lowest axis fastest.
+ * @param points the positions
+ * @param v the vertices of the cell
+ * @param numVerts the number of vertices, 4 or 8
+ * @param order output vtk order, as indices of the dx vertices
+ * @returns non-zero if the cell is a vtk voxel or pixel
+ */
+int GetAlignedOrder(const float *points, const int *v, int numVerts, int *order)
+{
+    int d,c,j,k,b;
+    int numDims;
+    int edges[VTK_DIM]; // the dx vertex at the end of the edge along each axis
+    const float *p0;
+
+    numDims = (numVerts == 8) ? 3 : 2;
+    p0 = points + 3*(size_t)v[0];
+    for (c=0;c<VTK_DIM;c++)
+    {
+        edges[c] = 0;
+    }
+    for (d=0;d<numDims;d++)
+    {
+        const float *p = points + 3*(size_t)v[1 << d];
+        int axis = -1;
+        for (c=0;c<VTK_DIM;c++)
+        {
+            if (p[c] != p0[c])
+            {
+                if (axis >= 0)
+                {
+                    return 0;
+                }
+                axis = c;
+            }
+        }
+        if (axis < 0 || p[axis] < p0[axis] || edges[axis] != 0)
+        {
+            return 0;
+        }
+        edges[axis] = 1 << d;
+    }
+    for (k=1;k<numVerts;k++)
+    {
+        const float *p = points + 3*(size_t)v[k];
+        for (c=0;c<VTK_DIM;c++)
+        {
+            float expected = (k & edges[c]) ? points[3*(size_t)v[edges[c]] + c] : p0[c];
+            if (p[c] != expected)
+            {
+                return 0;
+            }
+        }
+    }
+    for (j=0;j<numVerts;j++)
+    {
+        k = 0;
+        b = 0;
+        for (c=0;c<VTK_DIM;c++)
+        {
+            if (edges[c] != 0)
+            {
+                k |= ((j >> b) & 1) ? edges[c] : 0;
+                b++;
+            }
+        }
+        order[j] = k;
+    }
+    return 1;
+}
+
+/**
+ * @brief tests if the edges of a dx cell, from the slowest index to the 
+ * fastest, are right handed
+ * @details This is the sign of the triple product of the edges to the
+ * vertices 4, 2 and 1 of a cube. A quad takes the edges to its vertices 2
+ * and 1 with the z axis, i.e., the z component of its normal.
+ * @param points the positions
+ * @param v the vertices of the cell
+ * @param numVerts the number of vertices, 4 or 8
+ * @returns non-zero if the first order of the cell type applies
+ */
+int IsRightHanded(const float *points, const int *v, int numVerts)
+{
+    int c;
+    double e[VTK_DIM][VTK_DIM];
+    const float *p0;
+
+    p0 = points + 3*(size_t)v[0];
+    for (c=0;c<VTK_DIM;c++)
+    {
+        e[0][c] = (double)points[3*(size_t)v[numVerts/2] + c] - p0[c];
+        e[1][c] = (double)points[3*(size_t)v[numVerts/4] + c] - p0[c];
+        e[2][c] = (numVerts == 8) ? (double)points[3*(size_t)v[1] + c] - p0[c] : (double)(c == 2);
+    }
+    return e[0][0]*(e[1][1]*e[2][2] - e[1][2]*e[2][1])
+         + e[0][1]*(e[1][2]*e[2][0] - e[1][0]*e[2][2])
+         + e[0][2]*(e[1][0]*e[2][1] - e[1][1]*e[2][0]) > 0.0;
+}
+
+/**
+ * @brief remaps one range of dx cells to vtk cells
+ * @details run by ParallelFor. The vertices of each cell are read before 
+ * they are written, so the cells may be remapped in place.
+ */
+void RemapCellsTask(void *ctx, size_t r)
+{
+    remapJob *job;
+    size_t i,end;
+    int k;
+    int n;
+    int v[8];
+    int aligned[8];
+    const int *order;
+
+    job = (remapJob *)ctx;
+    n = job->numVerts;
+    end = (r + 1)*CELLS_PER_TASK;
+    end = (end < job->numCells) ? end : job->numCells;
+    for (i=r*CELLS_PER_TASK;i<end;i++)
+    {
+        const int *in = job->in + i*n;
+        int *out = job->out + i*n;
+        for (k=0;k<n;k++)
+        {
+            v[k] = in[k];
+        }
+        if (job->cellTypes != NULL && GetAlignedOrder(job->points,v,n,aligned))
+        {
+            for (k=0;k<n;k++)
+            {
+                out[k] = v[aligned[k]];
+            }
+            if (job->cellTypes != NULL)
+            {
+                job->cellTypes[i] = job->alignedType;
+            }
+        }
+        else
+        {
+            order = job->order;
+            if (job->mirrorOrder != NULL && !IsRightHanded(job->points,v,n))
+            {
+                order = job->mirrorOrder;
+            }
+            for (k=0;k<n;k++)
+            {
+                out[k] = v[order[k]];
+            }
+            if (job->cellTypes != NULL)
+            {
+                job->cellTypes[i] = job->cellType;
+            }
+        }
+    }
+}
+
+/**
+ * @brief remaps dx cubes or quads to vtk cells
+ * @details Cells are remapped in parallel. Axis aligned cells, if cell 
+ * types are asked for, become voxels or pixels, the others hexahedra or 
+ * quads. The handedness of each cube picks its order, all quads take the
+ * order of the first one, so that a surface keeps one orientation. A 
+ * buffer of our own is remapped in place, a borrowed one is left as it is
+ * for other fields.
+ * @param con the connections object, with 4 or 8 vertices per cell
+ * @param points the positions
+ * @param cells output cell vertices
+ * @param ownsCells output, set if cells must be freed with the vtk dataset
+ * @param cellTypes output type of each cell, or NULL
+ * @param numThreads the maximum number of threads to use
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxCells2Remapped(object *con, const float *points, int **cells, unsigned char *ownsCells, int *cellTypes, int numThreads)
+{
+    int rc;
+    int *in;
+    array *con_array;
+    remapJob job;
+
+    con_array = (array *)con->obj;
+    rc = dxArrayBuffer(con,(void **)&in,ownsCells);
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    *cells = in;
+    if (!(*ownsCells))
+    {
+        *cells = (int *)malloc(GetArraySize(con_array)*sizeof(int));
+        if (*cells == NULL)
+        {
+            return DX_MEMORY_ERROR;
+        }
+        *ownsCells = 1;
+    }
+
+    job.in = in;
+    job.out = *cells;
+    job.points = points;
+    job.numVerts = con_array->shape[0];
+    job.numCells = con_array->items;
+    if (job.numVerts == 8)
+    {
+        job.order = hexahedronOrder[0];
+        job.mirrorOrder = hexahedronOrder[1];
+    }
+    else
+    {
+        job.order = quadOrder[(job.numCells > 0 && IsRightHanded(points,in,4)) ? 0 : 1];
+        job.mirrorOrder = NULL;
+    }
+    job.cellType = (job.numVerts == 8) ? VTK_HEXAHEDRON : VTK_QUAD;
+    job.alignedType = (job.numVerts == 8) ? VTK_VOXEL : VTK_PIXEL;
+    job.cellTypes = cellTypes;
+    ParallelFor(numThreads,(job.numCells + CELLS_PER_TASK - 1)/CELLS_PER_TASK,RemapCellsTask,&job);
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief creates poly data from explicit positions and connections
+ * @details Lines are kept apart from polygons, every cell of a dx field
+ * has the same number of vertices. Points and cell vertices are borrowed
+ * as for unstructured grids, except for points in two dimensions, which are
+ * padded, and quads, which are reordered from the dx grid order.
+ * @param pos the positions object
+ * @param con the connections object
+ * @param numVerts the number of vertices of each cell, 2 for lines
+ * @param pddata output poly data
+ * @param numThreads the maximum number of threads used to reorder quads
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxArrays2Polydata(object *pos, object *con, int numVerts, polydata **pddata, int numThreads)
+{
+    int i;
+    int rc;
+    int numCells;
+    int *cellVerts;
+    int *cells;
+    unsigned char ownsCells;
+    polydata *pd;
+
+    if (((array *)con->obj)->shape[0] != numVerts)
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+    if ((pd = (polydata *)malloc(sizeof(polydata))) == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    memset(pd,0,sizeof(polydata));
+    *pddata = pd;
+    pd->numPoints = ((array *)pos->obj)->items;
+    numCells = ((array *)con->obj)->items;
+
+    rc = dxPositions2Points(pos,&(pd->points),&(pd->ownsPoints));
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    if (numVerts == 4)
+    {
+        rc = dxCells2Remapped(con,pd->points,&cells,&ownsCells,NULL,numThreads);
+    }
+    else
+    {
+        rc = dxArrayBuffer(con,(void **)&cells,&ownsCells);
+    }
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    cellVerts = (int *)malloc(numCells*sizeof(int));
+    if (cellVerts == NULL)
+    {
+        if (ownsCells)
+        {
+            free(cells);
+        }
+        return DX_MEMORY_ERROR;
+    }
+    for (i=0;i<numCells;i++)
+    {
+        cellVerts[i] = numVerts;
+    }
+
+    if (numVerts == 2)
+    {
+        pd->numLines = numCells;
+        pd->numLineVerts = cellVerts;
+        pd->lines = cells;
+        pd->ownsLines = ownsCells;
+    }
+    else
+    {
+        pd->numPolygons = numCells;
+        pd->numVerts = cellVerts;
+        pd->polygons = cells;
+        pd->ownsPolygons = ownsCells;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief creates a VTK dataset from a OpenDX Field object OpenDX file.
+ * @details uses the position and connection OpenDX field components to 
+ * construct a VTK dataset mesh. If the vtkFile already has a dataset, 
+ * shared with other fields, only the point and cell data are counted.
+ * @param field pointer to the field object wrapper
+ * @param pointer to the vtkFile structure to load to
+ * @returns DX_SUCCESS on completion, or an appropriate error code
+ */
+int dxField2VTKDataSet(object *fieldObject, vtkDataFile *vtkFile)
+{
+    int i;
+    int rc;
+    object * pos;
+    object * con;
+    field *fld;
+    gridpositions grid;
+    int counts[VTK_DIM];
+    float origin[VTK_DIM];
+    float deltas[VTK_DIM*VTK_DIM];
+    
+    pos = NULL;
+    con = NULL;
+    fld = (field *)(fieldObject->obj);
+#ifdef DEBUG
+    printf("Writing Field %d [%s] %hhu\n",fieldObject->number,fieldObject->name,fieldObject->isLoaded);
+    printf("Num Components: %d\n",fld->numComponents);
+#endif
+    
+    // identify the position (geometry) and connections (topology) components
+    // any other components are considered as data
+    for (i=0;i<fld->numComponents;i++)
+    {
+        object * comp;
+        comp = fld->components[i];
+        if (streq(fld->aliases[i],"positions"))
+        {
+            pos = comp;
+        }
+        else if (streq(fld->aliases[i],"connections"))
+        {
+            con = comp;
+        }
+        else 
+        {
+            array * data;
+            attribute *attr;
+            data = (array *)(comp->obj);
+            // test if data depends on positions or connections
+            attr = GetAttribute(comp,"dep");
+            if (attr != NULL)
+            {
+                if (streq(attr->string,"positions"))
+                {
+                
+                    if (data->rank == 0)
+                    {
+                        vtkFile->pointdata->numScalars++;
+                    }
+                    else if (data->rank == 1 && data->shape[0] == 3)
+                    {
+                        vtkFile->pointdata->numVectors++;
+                    }
+
+                }
+                else if (streq(attr->string,"connections"))
+                {
+                    if (data->rank == 0)
+                    {
+                        vtkFile->celldata->numScalars++;
+                    }
+                    else if ( data->rank == 1 && data->shape[0] == 3)
+                    {
+                        vtkFile->celldata->numVectors++;
+                    }
+
+                }
+            }
+        }
+    }
+   
+    // the geometry was converted once for all the fields that share it
+    if (vtkFile->dataset != NULL)
+    {
+        return DX_SUCCESS;
+    }
+
+    // a mesh needs both its positions and its connections
+    if (pos == NULL || con == NULL)
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+
+    // dx positions and connections map to a vtk data set type
+    grid.counts = counts;
+    grid.origin = origin;
+    grid.deltas = deltas;
+    if (GetGridPositions(pos,&grid) == DX_SUCCESS 
+        && (con->class == DX_GRIDCONNECTIONS || con->class == DX_MESHARRAY))
+    {
+        gridpositions *gp;
+        structuredPoints *spdata;
+        vtkFile->geometry = VTK_STRUCTURED_POINTS;
+
+        gp = &grid;
+        
+        spdata = (structuredPoints *)malloc(sizeof(structuredPoints));
+        if (spdata == NULL)
+        {
+            return DX_MEMORY_ERROR;
+        }
+
+        spdata->dimensions[0] = 1;
+        spdata->dimensions[1] = 1;
+        spdata->dimensions[2] = 1;
+
+        spdata->origin[0] = 0.0;
+        spdata->origin[1] = 0.0;
+        spdata->origin[2] = 0.0;
+
+        spdata->spacing[0] = 1.0;
+        spdata->spacing[1] = 1.0;
+        spdata->spacing[2] = 1.0;
+
+        // gridconnections are really not used
+        if (gp->numCounts > 3)
+        {
+            return DX_NOT_SUPPORTED_ERROR;
+        }
+
+        for (i=0;i<gp->numCounts;i++)
+        {
+            spdata->dimensions[i] = gp->counts[gp->numCounts - i -1];
+        }
+        
+        for (i=0;i<gp->numCounts;i++)
+        {
+            spdata->origin[i] = gp->origin[gp->numCounts - i -1];
+        }
+
+        // @todo we assume that deltas are orthogonal, if not then structured points is
+        // not the best dataset type... but not quite sure which on is the best yet.
+        for (i=0;i<gp->numCounts;i++)
+        {
+            spdata->spacing[i] = gp->deltas[(gp->numCounts - i -1)*(gp->numCounts + 1)];
+        }
+        
+        vtkFile->dataset = spdata;
+        return DX_SUCCESS;
+    }
+    else if (pos->class == DX_PRODUCTARRAY 
+             && (con->class == DX_GRIDCONNECTIONS || con->class == DX_MESHARRAY)
+             && (rc = dxProduct2RectilinearGrid(pos,(rectilinearGrid **)&(vtkFile->dataset))) != DX_NOT_SUPPORTED_ERROR)
+    {
+        // products of irregular axes keep only the coordinates of each axis
+        vtkFile->geometry = VTK_RECTILINEAR_GRID;
+        return rc;
+    }
+    else if (IsArrayObject(pos) 
+             && (con->class == DX_GRIDCONNECTIONS || con->class == DX_MESHARRAY))
+    {
+        // irregular positions on a grid need no cell connectivity
+        vtkFile->geometry = VTK_STRUCTURED_GRID;
+        return dxGrid2StructuredGrid(pos,con,(structuredGrid **)&(vtkFile->dataset));
+    }
+    else if (IsArrayObject(pos) && IsArrayObject(con))
+    {
+        array *pos_array;
+        array *con_array;
+        attribute *attr;
+        unstructuredGrid *ugdata;
+        // extract the geometry and topology
+        pos_array = (array *)pos->obj;
+        con_array = (array *)con->obj;
+
+        // positions in two dimensions are padded with z = 0
+        if (pos_array->type != DX_FLOAT || pos_array->rank != 1 
+            || (pos_array->shape[0] != 2 && pos_array->shape[0] != 3))
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+
+        if (con_array->type != DX_INT || con_array->rank != 1)
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+
+        // now the cell data (may need to re-map verts) this depends 
+        // the element type attribute
+        attr = GetAttribute(con,"element type");
+        if (attr == NULL)
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+
+        // lines and surfaces are poly data, which needs no cell types
+        if (streq(attr->string,"lines"))
+        {
+            vtkFile->geometry = VTK_POLYDATA;
+            return dxArrays2Polydata(pos,con,2,(polydata **)&(vtkFile->dataset),vtkFile->numThreads);
+        }
+        else if (streq(attr->string,"triangles"))
+        {
+            vtkFile->geometry = VTK_POLYDATA;
+            return dxArrays2Polydata(pos,con,3,(polydata **)&(vtkFile->dataset),vtkFile->numThreads);
+        }
+        else if (streq(attr->string,"quads"))
+        {
+            vtkFile->geometry = VTK_POLYDATA;
+            return dxArrays2Polydata(pos,con,4,(polydata **)&(vtkFile->dataset),vtkFile->numThreads);
+        }
+
+#ifdef DEBUG
+    printf("get here?\n");
+#endif
+        vtkFile->geometry = VTK_UNSTRUCTURED_GRID;
+        if ((ugdata = (unstructuredGrid *)malloc(sizeof(unstructuredGrid))) == NULL)
+        {
+            return DX_MEMORY_ERROR;
+        }
+        // attached at once, so that VTK_Free() releases a partial grid
+        memset(ugdata,0,sizeof(unstructuredGrid));
+        vtkFile->dataset = ugdata;
+
+        // get the number of positions, this maps to points
+        ugdata->numPoints = pos_array->items;
+        // now the number of cells
+        ugdata->numCells = con_array->items;
+
+        // points and cells are borrowed from the dx arrays, which must
+        // stay loaded until the vtk file is freed
+        rc = dxPositions2Points(pos,&(ugdata->points),&(ugdata->ownsPoints));
+        if (rc != DX_SUCCESS)
+        {
+            return rc;
+        }
+
+        // allocate memory for cell sizes and types
+        ugdata->numVerts = (int *)malloc((ugdata->numCells)*sizeof(int));
+        ugdata->cellTypes = (int *)malloc((ugdata->numCells)*sizeof(int));
+
+        if ((ugdata->numVerts == NULL) || (ugdata->cellTypes == NULL))
+        {
+            return DX_MEMORY_ERROR;
+        }
+
+        // determine the element type required and map accordingly
+        if (streq(attr->string,"cubes") || streq(attr->string,"cubes2D") || streq(attr->string,"cubesnD"))
+        {
+            int n = con_array->shape[0];
+            // cubesnD are supported in two and three dimensions
+            if ((n != 8 && n != 4) || (streq(attr->string,"cubes") && n != 8) 
+                || (streq(attr->string,"cubes2D") && n != 4))
+            {
+                return DX_NOT_SUPPORTED_ERROR;
+            }
+            // voxels and pixels where the cells are axis aligned, otherwise
+            // hexahedra and quads with their vertices reordered
+            rc = dxCells2Remapped(con,ugdata->points,&(ugdata->cells),&(ugdata->ownsCells),ugdata->cellTypes,vtkFile->numThreads);
+            if (rc != DX_SUCCESS)
+            {
+                return rc;
+            }
+            for (i=0;i<ugdata->numCells;i++)
+            {
+                ugdata->numVerts[i] = n;
+            }
+        }
+        else if (streq(attr->string,"tetrahedra"))
+        {
+            rc = dxArrayBuffer(con,(void **)&(ugdata->cells),&(ugdata->ownsCells));
+            if (rc != DX_SUCCESS)
+            {
+                return rc;
+            }
+            for (i=0;i<ugdata->numCells;i++)
+            {
+                ugdata->numVerts[i] = 4;
+                ugdata->cellTypes[i] = VTK_TETRA; 
+            }
+        }
+        else
+        {
+            return DX_NOT_SUPPORTED_ERROR;
+        }
+        
+        return DX_SUCCESS;
+    }
+    else
+    {
+        return DX_NOT_SUPPORTED_ERROR;
+    }
+
+}
+
+/**
+ * @brief expands values of an implicit dx array for the vtk writer
+ * @details The writer asks for values, not items, so a range that splits 
+ * items is expanded through a buffer of the whole items.
+ * @param ctx the dx array object
+ * @param first the first value
+ * @param n the number of values
+ * @param values output values in host order
+ * @returns VTK_SUCCESS on completion, otherwise an appropriate error code
+ */
+int ExpandValues(const void *ctx, size_t first, size_t n, void *values)
+{
+    object *arrayObject;
+    array *data_array;
+    size_t m;
+    size_t firstItem;
+    size_t numItems;
+    void *buf;
+    int rc;
+
+    arrayObject = (object *)ctx;
+    data_array = (array *)arrayObject->obj;
+    m = GetItemSize(data_array);
+    if (first % m == 0 && n % m == 0)
+    {
+        rc = DX_ExpandArray(arrayObject,first/m,n/m,values);
+        return (rc == DX_SUCCESS) ? VTK_SUCCESS : VTK_INVALID_FILE_ERROR;
+    }
+
+    firstItem = first/m;
+    numItems = (first + n + m - 1)/m - firstItem;
+    buf = malloc(numItems*m*GetTypeSize(data_array->type));
+    if (buf == NULL)
+    {
+        return VTK_MEMORY_ERROR;
+    }
+    rc = DX_ExpandArray(arrayObject,firstItem,numItems,buf);
+    if (rc == DX_SUCCESS)
+    {
+        memcpy(values,(char *)buf + (first - firstItem*m)*GetTypeSize(data_array->type),n*GetTypeSize(data_array->type));
+    }
+    free(buf);
+    return (rc == DX_SUCCESS) ? VTK_SUCCESS : VTK_INVALID_FILE_ERROR;
+}
+
+/**
+ * @brief gets the values of an OpenDX array for a vtk dataset
+ * @details A loaded array buffer is borrowed. An external binary array left
+ * on disk (see dxFile.deferExternal) is described by a source instead, so 
+ * the writer streams it from its file and it is never held in memory. An
+ * implicit array is kept implicit, the writer expands one window at a time.
+ * @param arrayObject the dx array
+ * @param values output pointer to the values, NULL if source is used
+ * @param ownsValues output, set if values must be freed with the vtk dataset
+ * @param source output source of the values, if values is NULL
+ */
+void dxArrayValues(object *arrayObject, void **values, unsigned char *ownsValues, vtkSource *source)
+{
+    array *data_array;
+
+    data_array = (array *)arrayObject->obj;
+    *values = data_array->data;
+    *ownsValues = 0;
+    source->filename = NULL;
+    source->offset = 0;
+    source->bigEndian = 0;
+    source->expand = NULL;
+    source->ctx = NULL;
+    if (arrayObject->class != DX_ARRAY)
+    {
+        source->expand = ExpandValues;
+        source->ctx = arrayObject;
+    }
+    else if (data_array->data == NULL && data_array->dataMode == DX_FILE)
+    {
+        source->filename = data_array->file;
+        source->offset = data_array->offset;
+        source->bigEndian = (data_array->endian == DX_MSB);
+    }
+}
+
+/**
+ * @brief converts an OpenDX data array into a vtk data attribute
+ * @details Arrays in OpenDx can be scalar, vector, or tensor etc... however
+ * vtk does provide a disinction here. so the the converison is done and then appended
+ * a vtkData object, whic could be cell or point data.
+ * @param arrayObject a pointer to the object wrapper for the data array to convert
+ * @param alias the name of the array in its field
+ * @param data pointer to the vtkdata object (will either be cell or point data)
+ * @returns DX_SUCCESS or completion, otherwise an appropriate error is returned
+ * @note this function modifies the vtk data object, it will append scalar, vectoror tensor
+ * data as required. The data buffer is borrowed from the dx array, so the array must stay
+ * loaded until the vtk data is freed.
+ * @see dxArrayValues()
+ */
+int dxArray2vtkData(object *arrayObject, const char *alias, vtkData* data)
+{
+    if (!(streq(alias,"positions") || streq(alias,"connections")))
+    {
+        array * data_array;
+        data_array = (array *)arrayObject->obj;
+      
+        if (data_array->type != DX_INT && data_array->type != DX_FLOAT)
+        {
+            return DX_NOT_SUPPORTED_ERROR;
+        }
+
+        // the dx buffer is borrowed, not copied
+        if (data_array->rank == 0)
+        {
+            scalar *sd;
+            sd = &(data->scalar_data[data->numScalars]);
+            dxArrayValues(arrayObject,&(sd->data),&(sd->ownsData),&(sd->source));
+            sd->type = data_array->type;
+            snprintf(sd->name,sizeof(sd->name),"%s",alias);
+            data->numScalars++;
+        }
+        else if (data_array->rank == 1 && data_array->shape[0] == 3)
+        {
+            vector *vd;
+            vd = &(data->vector_data[data->numVectors]);
+            dxArrayValues(arrayObject,&(vd->data),&(vd->ownsData),&(vd->source));
+            vd->type = data_array->type;
+            snprintf(vd->name,sizeof(vd->name),"%s",alias);
+            data->numVectors++;
+        }
+        else
+        {
+            return DX_SUCCESS;
+        }
+        
+        data->size = data_array->items;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief finds the fields to convert, one per output file
+ * @details If the file contains a series or a group then its members are used,
+ * otherwise the lone field is used.
+ * @param dxf dx file pointer
+ * @param fields output array of field object pointers
+ * @param numFields output number of fields
+ * @returns DX_SUCCESS on completion, otherwise an appropriate error code
+ */
+int GetFieldObjects(dxFile *dxf, object ***fields, int *numFields)
+{
+    int i;
+    int n;
+    object ** fieldObjects;
+    series * seriesHeader;
+    group * groupHeader;
+
+    seriesHeader = NULL;
+    groupHeader = NULL;
+
+    n = 1; 
+    // check if any groups or series data exists
+    // Assumption: only one group or one series may exist in a single file
+    for (i=0;i<dxf->numObjects;i++)
+    {
+        if (dxf->objs[i].class == DX_SERIES)
+        {
+            seriesHeader = (series *)dxf->objs[i].obj;
+            n = seriesHeader->numMembers;
+#ifdef DEBUG
+            printf("found Series %s members %d\n",dxf->objs[i].name,n);
+#endif
+            break;
+        }
+        else if (dxf->objs[i].class == DX_GROUP)
+        {
+            groupHeader = (group *)dxf->objs[i].obj;
+            n = groupHeader->numMembers;
+#ifdef DEBUG
+            printf("found Group %s members %d\n",dxf->objs[i].name,n);
+#endif
+            break;
+        }
+    }
+    // allocate memeory for field pointers
+    fieldObjects = (object **)malloc(n*sizeof(object*));
+    if (fieldObjects == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+
+    // get the list of fields to convert
+    if (seriesHeader != NULL)
+    {
+        for (i=0;i<seriesHeader->numMembers;i++)
+        {
+            fieldObjects[i] = seriesHeader->members[i];
+        }
+    }
+    else if (groupHeader != NULL)
+    {
+        for (i=0;i<groupHeader->numMembers;i++)
+        {
+            fieldObjects[i] = groupHeader->members[i];
+        }
+    }
+    else
+    {
+        // no groups or series, so there must just be a lone field
+        fieldObjects[0] = NULL;
+        for (i=0;i<dxf->numObjects;i++)
+        {
+            if (dxf->objs[i].class == DX_FIELD)
+            {
+                fieldObjects[0] = &(dxf->objs[i]);        
+            }
+        }
+        if (fieldObjects[0] == NULL)
+        {
+            free(fieldObjects);
+            return DX_INVALID_FILE_ERROR;
+        }
+    }
+
+    *fields = fieldObjects;
+    *numFields = n;
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief finds the positions of the members of a series
+ * @param dxf dx file pointer, with the series loaded
+ * @returns the position of each member, or NULL if there is no series
+ */
+float * GetSeriesPositions(dxFile *dxf)
+{
+    int i;
+    for (i=0;i<dxf->numObjects;i++)
+    {
+        if (dxf->objs[i].class == DX_SERIES && dxf->objs[i].isLoaded)
+        {
+            return ((series *)dxf->objs[i].obj)->positions;
+        }
+        else if (dxf->objs[i].class == DX_GROUP)
+        {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gets the filename of the collection file of a whole series from 
+ * the output filename pattern
+ * @details The pattern is cut at its first conversion, or at its extension
+ * if it has none, trailing separators are removed and the suffix is 
+ * appended, e.g., out/step_%04d.vtu and .pvd give out/step.pvd.
+ * @param pattern the output filename pattern
+ * @param suffix appended to the base name
+ * @param name the output buffer
+ * @param size the size of the output buffer
+ */
+void GetPatternFilename(const char *pattern, const char *suffix, char *name, int size)
+{
+    char *base;
+    char *end;
+
+    strncpy(name,pattern,size - 1);
+    name[size - 1] = '\0';
+    base = strrchr(name,'/');
+    base = (base == NULL) ? name : base + 1;
+    end = strchr(base,'%');
+    if (end == NULL)
+    {
+        end = strrchr(base,'.');
+    }
+    if (end != NULL)
+    {
+        *end = '\0';
+    }
+    end = base + strlen(base);
+    while (end > base && (end[-1] == '_' || end[-1] == '-' || end[-1] == '.'))
+    {
+        *(--end) = '\0';
+    }
+    if (end == base)
+    {
+        strncat(name,"series",size - strlen(name) - 1);
+    }
+    strncat(name,suffix,size - strlen(name) - 1);
+}
+
+/**
+ * @brief writes a collection file that maps each output file of a series
+ * to the position of its member, as the time step
+ * @param pattern the output filename pattern, member i is written to file i
+ * @param positions the series positions
+ * @param n the number of members
+ * @returns DX_SUCCESS on completion, otherwise an appropriate error code
+ */
+int WriteSeriesCollection(const char *pattern, float *positions, int n)
+{
+    char collection[DX_MAX_FILENAME_LENGTH];
+    char **files;
+    char *names;
+    const char *dir;
+    int i;
+    int rc;
+
+    files = (char **)malloc(n*sizeof(char *));
+    names = (char *)malloc((size_t)n*DX_MAX_FILENAME_LENGTH);
+    if (files == NULL || names == NULL)
+    {
+        free(files);
+        free(names);
+        return DX_MEMORY_ERROR;
+    }
+    // the collection is next to the files, so it refers to them by name
+    dir = strrchr(pattern,'/');
+    dir = (dir == NULL) ? pattern : dir + 1;
+    for (i=0;i<n;i++)
+    {
+        files[i] = names + (size_t)i*DX_MAX_FILENAME_LENGTH;
+        snprintf(files[i],DX_MAX_FILENAME_LENGTH,dir,i);
+    }
+    GetPatternFilename(pattern,".pvd",collection,DX_MAX_FILENAME_LENGTH);
+    rc = VTK_WriteCollection(collection,files,positions,n);
+    free(files);
+    free(names);
+    return (rc == VTK_SUCCESS) ? DX_SUCCESS : DX_FILE_NOT_FOUND_ERROR;
+}
+
+/**
+ * @brief converts a single dx field to a vtk data file
+ * @details The field must be loaded. The returned structure borrows the
+ * array buffers of the field, so the field must stay loaded until the vtk 
+ * file is freed with VTK_Free(). Different fields may be converted 
+ * concurrently.
+ * @param dxf dx file pointer
+ * @param fieldObject the field to convert
+ * @param vtkf output vtk file pointer
+ * @param type the vtk data type, VTK_ASCII, VTK_BINARY or VTK_XML
+ * @param shared geometry already converted for another field with the same
+ * positions and connections, borrowed by the vtk file, or NULL
+ * @param numThreads the maximum number of threads used to convert and 
+ * format the field
+ * @returns DX_SUCCESS on completion, otherwise an appropriate error code
+ */
+int dxField2vtkDataFile(dxFile *dxf, object *fieldObject, vtkDataFile **vtkf, char type, sharedGeometry *shared, int numThreads)
+{
+    int j;
+    int rc;
+    field * fieldHeader;
+    vtkDataFile *vtkFile;
+
+    vtkFile = (vtkDataFile *)malloc(sizeof(vtkDataFile));
+    if (vtkFile == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    vtkFile->pointdata = (vtkData *)malloc(sizeof(vtkData));
+    if (vtkFile->pointdata == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    vtkFile->celldata = (vtkData *)malloc(sizeof(vtkData));
+    if (vtkFile->celldata == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+
+    // store the header info
+    sprintf(vtkFile->vtkVersion,"%s",VTK_VERSION);
+    snprintf(vtkFile->title,VTK_TITLE_LENGTH,"Converted from OpenDX file %s field %s\n",dxf->filename,fieldObject->name);
+
+    vtkFile->dataType = type;
+    vtkFile->numThreads = numThreads;
+    vtkFile->memoryBudget = VTK_MEMORY_BUDGET_DEFAULT;
+    vtkFile->compressor = VTK_COMPRESSOR_NONE;
+    vtkFile->dataset = NULL;
+    vtkFile->ownsDataset = 1;
+    if (shared != NULL)
+    {
+        vtkFile->geometry = shared->geometry;
+        vtkFile->dataset = shared->dataset;
+        vtkFile->ownsDataset = 0;
+    }
+    vtkFile->pointdata->numScalars = 0;
+    vtkFile->pointdata->numVectors = 0;
+    vtkFile->celldata->numScalars = 0;
+    vtkFile->celldata->numVectors = 0;
+#ifdef DEBUG
+    printf("VTK file header [field %s]\n",fieldObject->name);
+    printf("\t# vtk DataFile Version %s\n",vtkFile->vtkVersion);
+    printf("\t%s\n",vtkFile->title);
+#endif
+    rc = dxField2VTKDataSet(fieldObject, vtkFile);
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    
+    // allocate memory for pointt and cell data
+    vtkFile->pointdata->scalar_data = (scalar *)malloc((vtkFile->pointdata->numScalars)*sizeof(scalar));
+    vtkFile->pointdata->vector_data = (vector *)malloc((vtkFile->pointdata->numVectors)*sizeof(vector));
+    if (vtkFile->pointdata->scalar_data == NULL || vtkFile->pointdata->vector_data == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    vtkFile->celldata->scalar_data = (scalar *)malloc((vtkFile->celldata->numScalars)*sizeof(scalar));
+    vtkFile->celldata->vector_data = (vector *)malloc((vtkFile->celldata->numVectors)*sizeof(vector));
+    if (vtkFile->celldata->scalar_data == NULL || vtkFile->celldata->vector_data == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+
+    // reset to zero as we now use these as an index... a bit of a hack
+    vtkFile->pointdata->numScalars = 0;
+    vtkFile->pointdata->numVectors = 0;
+    vtkFile->celldata->numScalars = 0;
+    vtkFile->celldata->numVectors = 0;
+    vtkFile->pointdata->size = 0;
+    vtkFile->celldata->size = 0;
+    // convert each component 
+    fieldHeader = (field *)(fieldObject->obj);
+    for (j=0;j<fieldHeader->numComponents;j++)
+    {
+        if (IsArrayObject(fieldHeader->components[j]))
         {
-            for (i=0;i<ugdata->numCells;i++)
+            attribute * attr;
+            attr = GetAttribute(fieldHeader->components[j],"dep");
+            if (attr != NULL)
             {
-                ugdata->numVerts[i] = 4;
-                ugdata->cellTypes[i] = VTK_TETRA; 
+                rc = DX_SUCCESS;
+                if (streq(attr->string,"positions"))
+                {
+                    rc = dxArray2vtkData(fieldHeader->components[j],fieldHeader->aliases[j],vtkFile->pointdata);
+                }
+                else if (streq(attr->string,"connections"))
+                {
+                    rc = dxArray2vtkData(fieldHeader->components[j],fieldHeader->aliases[j],vtkFile->celldata);
+                }
+                if (rc != DX_SUCCESS)
+                {
+                    return rc;
+                }
             }
-            // again simple enough
-            memcpy((void*)ugdata->cells,con_array->data,(con_array->shape[0])*(con_array->items)*sizeof(int));
+
         }
-        
-        vtkFile->dataset = ugdata;
-        return DX_SUCCESS;
-    }
-    else
-    {
-        return DX_NOT_SUPPORTED_ERROR;
     }
 
+    *vtkf = vtkFile;
+    return DX_SUCCESS;
 }
 
 /**
- * @brief converts an OpenDX data array into a vtk data attribute
- * @details Arrays in OpenDx can be scalar, vector, or tensor etc... however
- * vtk does provide a disinction here. so the the converison is done and then appended
- * a vtkData object, whic could be cell or point data.
- * @param arrayObject a pointer to the object wrapper for the data array to convert
- * @param data pointer to the vtkdata object (will either be cell or point data)
- * @returns DX_SUCCESS or completion, otherwise an appropriate error is returned
- * @note this function modifies the vtk data object, it will append scalar, vectoror tensor
- * data as required. 
+ * @brief finds the converted geometry of a positions and connections pair
+ * @note The caller must hold the job lock.
+ * @param job the conversion job
+ * @param pos the positions object
+ * @param con the connections object
+ * @returns the shared geometry, or NULL if it has not been converted yet
  */
-int dxArray2vtkData(object *arrayObject, vtkData* data)
+sharedGeometry * FindGeometry(conversionJob *job, object *pos, object *con)
 {
-    int i,j,k;
-    // reset to use as an index
-    j = data->numScalars;
-    k = data->numVectors;
-    void * dst;
-
-    if (!(streq(arrayObject->alias,"positions") || streq(arrayObject->alias,"connections")))
+    int i;
+    for (i=0;i<job->numGeometries;i++)
     {
-        array * data_array;
-        size_t nbytes;
-        data_array = (array *)arrayObject->obj;
-      
-        switch(data_array->type)
+        if (job->geometries[i].positions == pos && job->geometries[i].connections == con)
         {
-            case DX_INT:
-                nbytes = DX_INT_SIZE;
-                break;
-            case DX_FLOAT:
-                nbytes = DX_FLOAT_SIZE;
-                break;
+            return job->geometries + i;
         }
+    }
+    return NULL;
+}
 
-        if (data_array->rank == 0)
+/**
+ * @brief shares the dataset of a converted field with the other fields 
+ * that reference the same positions and connections
+ * @details The job takes over the dataset. When streaming, the positions 
+ * and connections are acquired once more, so the buffers the dataset 
+ * borrows stay loaded until FreeGeometries(). If another task shared the 
+ * same geometry first, the output keeps its own dataset.
+ * @param job the conversion job
+ * @param pos the positions object
+ * @param con the connections object
+ * @param output the converted field
+ * @returns DX_SUCCESS on completion, otherwise an appropriate error code
+ */
+int ShareGeometry(conversionJob *job, object *pos, object *con, vtkDataFile *output)
+{
+    sharedGeometry *g;
+    int rc;
+
+    rc = DX_SUCCESS;
+    pthread_mutex_lock(&(job->lock));
+    g = FindGeometry(job,pos,con);
+    if (g == NULL)
+    {
+        if (job->stream)
         {
-            data->scalar_data[data->numScalars].data = malloc(nbytes*data_array->items);
-            if (data->scalar_data[data->numScalars].data == NULL)
+            rc = DX_AcquireObject(job->dxf,pos);
+            if (rc == DX_SUCCESS)
             {
-                return DX_MEMORY_ERROR;
+                rc = DX_AcquireObject(job->dxf,con);
+                if (rc != DX_SUCCESS)
+                {
+                    DX_ReleaseObject(job->dxf,pos);
+                }
             }
-            data->scalar_data[data->numScalars].type = data_array->type;
-            strncpy(data->scalar_data[data->numScalars].name,arrayObject->alias,DX_MAX_TOKEN_LENGTH);
-            dst = (void *) data->scalar_data[data->numScalars].data;
-            data->numScalars++;
         }
-        else if (data_array->rank == 1 && data_array->shape[0] == 3)
+        if (rc == DX_SUCCESS)
         {
-            nbytes *= data_array->shape[0];
-            data->vector_data[data->numVectors].data = malloc(nbytes*(data_array->items));
-            if (data->vector_data[data->numVectors].data == NULL)
-            {
-                return DX_MEMORY_ERROR;
-            }
-                // copydata
-            memcpy(data->vector_data[k].data,data_array->data,nbytes*(data_array->items)*data_array->shape[0]);
-            data->vector_data[data->numVectors].type = data_array->type;
-            strncpy(data->vector_data[data->numVectors].name,arrayObject->alias,DX_MAX_TOKEN_LENGTH);
-            dst = (void *)data->vector_data[data->numVectors].data;
-            data->numVectors++;
+            g = job->geometries + job->numGeometries;
+            g->positions = pos;
+            g->connections = con;
+            g->geometry = output->geometry;
+            g->dataset = output->dataset;
+            output->ownsDataset = 0;
+            job->numGeometries++;
         }
-        
-        data->size = data_array->items;
-        // copydata
-        memcpy(dst,data_array->data,nbytes*data_array->items);
     }
-    return DX_SUCCESS;
+    pthread_mutex_unlock(&(job->lock));
+    return rc;
 }
 
-
-
 /**
- * @brief converts a dx file to a vtk file
- * @detials deteremines from the field infomation (e.g., positions, connections etc)
- * the type of vtk data to use.
- * @param dxf dx file pointer
- * @param vtkf vtk file pointer
- *
+ * @brief frees the shared geometries of a conversion job
+ * @details When streaming, this releases the positions and connections, so
+ * it must be called before the dx file is closed.
+ * @param job the conversion job
  */
-int dxFile2vtkDataFiles(dxFile *dxf, vtkDataFile ***vtkf, int * numFiles,char type)
+void FreeGeometries(conversionJob *job)
 {
-    int i,j,k;
-    int numFields;
-    object * obj;
-    object * positions;
-    object * connections;
-    
-    object ** fieldObjects;
-    series * seriesHeader;
-    group * groupHeader;
-
-    vtkDataFile **vtkFiles;
-
-    seriesHeader = NULL;
-    groupHeader = NULL;
-
-    numFields = 1; 
-    // check if any groups or series data exists
-    // Assumption: only one group or one series may exist in a single file
-    for (i=0;i<dxf->numObjects;i++)
+    int i;
+    for (i=0;i<job->numGeometries;i++)
     {
-        if (dxf->objs[i].class == DX_SERIES)
-        {
-            seriesHeader = (series *)dxf->objs[i].obj;
-            numFields = seriesHeader->numMembers;
-#ifdef DEBUG
-            printf("found Series %s members %d\n",dxf->objs[i].name,numFields);
-#endif
-            break;
-        }
-        else if (dxf->objs[i].class == DX_GROUP)
+        vtkDataFile geometryFile;
+        memset(&geometryFile,0,sizeof(vtkDataFile));
+        geometryFile.geometry = job->geometries[i].geometry;
+        geometryFile.dataset = job->geometries[i].dataset;
+        geometryFile.ownsDataset = 1;
+        VTK_Free(&geometryFile);
+        if (job->stream)
         {
-            groupHeader = (group *)dxf->objs[i].obj;
-            numFields = groupHeader->numMembers;
-#ifdef DEBUG
-            printf("found Group %s members %d\n",dxf->objs[i].name,numFields);
-#endif
-            break;
+            DX_ReleaseObject(job->dxf,job->geometries[i].connections);
+            DX_ReleaseObject(job->dxf,job->geometries[i].positions);
         }
     }
-    // allocate memeory for field pointers
-    fieldObjects = (object **)malloc(numFields*sizeof(object*));
-    if (fieldObjects == NULL)
-    {
-        return DX_MEMORY_ERROR;
-    }
+    free(job->geometries);
+    job->geometries = NULL;
+    job->numGeometries = 0;
+}
+
+/**
+ * @brief converts field i of a conversion job and writes it to its own file
+ * @details run by ParallelFor, each task touches only its own vtkDataFile and
+ * output stream. When streaming, the field is loaded before conversion and 
+ * released once its file is written, so only the fields in flight are held
+ * in memory. Fields with the same positions and connections share one 
+ * converted geometry. The first error code is kept in the job.
+ */
+void ConvertFieldTask(void *ctx, size_t i)
+{
+    conversionJob *job;
+    vtkDataFile *output;
+    sharedGeometry *shared;
+    object *pos;
+    object *con;
+    char vtkfilename[DX_MAX_FILENAME_LENGTH];
+    int rc;
 
-    // allocate memory for vtkdatafile structures
-    vtkFiles = (vtkDataFile **)malloc(numFields*sizeof(vtkFiles));
-    if (vtkFiles == NULL)
+    job = (conversionJob *)ctx;
+    if (job->rc != DX_SUCCESS)
     {
-        return DX_MEMORY_ERROR;
+        return;
     }
 
-    for (i=0;i<numFields;i++)
+    if (job->stream)
     {
-        vtkFiles[i] = (vtkDataFile *)malloc(sizeof(vtkDataFile));
-        if (vtkFiles[i] == NULL)
-        {
-            return DX_MEMORY_ERROR;
-        }
-        vtkFiles[i]->pointdata = (vtkData *)malloc(sizeof(vtkData));
-        if (vtkFiles[i]->pointdata == NULL)
-        {
-            return DX_MEMORY_ERROR;
-        }
-        vtkFiles[i]->celldata = (vtkData *)malloc(sizeof(vtkData));
-        if (vtkFiles[i]->celldata == NULL)
+        pthread_mutex_lock(&(job->lock));
+        rc = DX_AcquireObject(job->dxf,job->fields[i]);
+        pthread_mutex_unlock(&(job->lock));
+        if (rc != DX_SUCCESS)
         {
-            return DX_MEMORY_ERROR;
+            fprintf(stderr,"Error: Could not Load field %s [code: %d]\n",job->fields[i]->name,rc);
+            __sync_bool_compare_and_swap(&(job->rc),DX_SUCCESS,rc);
+            return;
         }
     }
 
+    GetFieldGeometry(job->fields[i],&pos,&con);
+    shared = NULL;
+    if (pos != NULL && con != NULL)
+    {
+        pthread_mutex_lock(&(job->lock));
+        shared = FindGeometry(job,pos,con);
+        pthread_mutex_unlock(&(job->lock));
+    }
+    rc = dxField2vtkDataFile(job->dxf,job->fields[i],&output,job->type,shared,job->formatThreads);
+    if (rc == DX_SUCCESS && shared == NULL && pos != NULL && con != NULL)
+    {
+        rc = ShareGeometry(job,pos,con,output);
+    }
+    if (rc != DX_SUCCESS)
+    {
+        fprintf(stderr,"Error: Conversion of field %s failed [code %d]\n",job->fields[i]->name,rc);
+        __sync_bool_compare_and_swap(&(job->rc),DX_SUCCESS,rc);
+        return;
+    }
 
-    // get the list of fields to convert
-    if (seriesHeader != NULL)
+    output->memoryBudget = job->memoryBudget;
+    output->compressor = job->compressor;
+    snprintf(vtkfilename,DX_MAX_FILENAME_LENGTH,job->pattern,(int)i);
+    if (VTK_Open(output,vtkfilename) != VTK_SUCCESS)
     {
-        for (i=0;i<seriesHeader->numMembers;i++)
-        {
-            fieldObjects[i] = seriesHeader->members[i];
-        }
+        fprintf(stderr,"Error: Could not open VTK file %s\n",vtkfilename);
+        __sync_bool_compare_and_swap(&(job->rc),DX_SUCCESS,DX_FILE_NOT_FOUND_ERROR);
+        return;
     }
-    else if (groupHeader != NULL)
+    if (job->type == VTK_XML)
     {
-        for (i=0;i<groupHeader->numMembers;i++)
-        {
-            fieldObjects[i] = groupHeader->members[i];
-        }
+        rc = VTK_WriteXML(output);
     }
     else
     {
-        // no groups or series, so there must just be a lone field
-        for (i=0;i<dxf->numObjects;i++)
-        {
-            if (dxf->objs[i].class == DX_FIELD)
-            {
-                fieldObjects[0] = &(dxf->objs[i]);        
-            }
-        }
+        rc = VTK_Write(output);
     }
-
-    // now do the conversions
-    for (i=0;i<numFields;i++)
+    // late write errors are only seen when the file is closed
+    if (VTK_Close(output) != VTK_SUCCESS && rc == VTK_SUCCESS)
     {
-        int rc;
-        field * fieldHeader;
-        // store the header info
-        sprintf(vtkFiles[i]->vtkVersion,"%s",VTK_VERSION);
-        sprintf(vtkFiles[i]->title,"Converted from OpenDX file %s field %s\n",dxf->filename,fieldObjects[i]->name);
-    
-        vtkFiles[i]->dataType = type;
-        vtkFiles[i]->pointdata->numScalars = 0;
-        vtkFiles[i]->pointdata->numVectors = 0;
-        vtkFiles[i]->celldata->numScalars = 0;
-        vtkFiles[i]->celldata->numVectors = 0;
-#ifdef DEBUG
-        printf("VTK file header [file %d of %d]\n",i,numFields);
-        printf("\t# vtk DataFile Version %s\n",vtkFiles[i]->vtkVersion);
-        printf("\t%s\n",vtkFiles[i]->title);
-#endif
-        rc = dxField2VTKDataSet(fieldObjects[i], vtkFiles[i]);
-        if (rc != DX_SUCCESS)
-        {
-            return rc;
-        }
-        
-        // allocate memory for pointt and cell data
-        vtkFiles[i]->pointdata->scalar_data = (scalar *)malloc((vtkFiles[i]->pointdata->numScalars)*sizeof(scalar));
-        vtkFiles[i]->pointdata->vector_data = (vector *)malloc((vtkFiles[i]->pointdata->numVectors)*sizeof(vector));
-        if (vtkFiles[i]->pointdata->scalar_data == NULL || vtkFiles[i]->pointdata->vector_data == NULL)
-        {
-            return DX_MEMORY_ERROR;
-        }
-        vtkFiles[i]->celldata->scalar_data = (scalar *)malloc((vtkFiles[i]->celldata->numScalars)*sizeof(scalar));
-        vtkFiles[i]->celldata->vector_data = (vector *)malloc((vtkFiles[i]->celldata->numVectors)*sizeof(vector));
-        if (vtkFiles[i]->celldata->scalar_data == NULL || vtkFiles[i]->celldata->vector_data == NULL)
-        {
-            return DX_MEMORY_ERROR;
-        }
-
-        // reset to zero as we now use these as an index... a bit of a hack
-        vtkFiles[i]->pointdata->numScalars = 0;
-        vtkFiles[i]->pointdata->numVectors = 0;
-        vtkFiles[i]->celldata->numScalars = 0;
-        vtkFiles[i]->celldata->numVectors = 0;
-        vtkFiles[i]->pointdata->size = 0;
-        vtkFiles[i]->celldata->size = 0;
-        // convert each component 
-        fieldHeader = (field *)(fieldObjects[i]->obj);
-        for (j=0;j<fieldHeader->numComponents;j++)
-        {
-            if (fieldHeader->components[j]->class == DX_ARRAY)
-            {
-                attribute * attr;
-                attr = GetAttribute(fieldHeader->components[j],"dep");
-                if (attr != NULL)
-                {
-                    if (streq(attr->string,"positions"))
-                    {
-                        rc = dxArray2vtkData(fieldHeader->components[j],vtkFiles[i]->pointdata);
-                    }
-                    else if (streq(attr->string,"connections"))
-                    {
-                        rc = dxArray2vtkData(fieldHeader->components[j],vtkFiles[i]->celldata);
-                    }
-                    if (rc != DX_SUCCESS)
-                    {
-                        return rc;
-                    }
-                }
-
-            }
-        }
+        rc = VTK_FILE_ERROR;
+    }
+    if (rc != VTK_SUCCESS)
+    {
+        fprintf(stderr,"Error: Could not write VTK file %s [code %d]\n",vtkfilename,rc);
+        __sync_bool_compare_and_swap(&(job->rc),DX_SUCCESS,DX_INVALID_FILE_ERROR);
     }
-//
-//    
-    *vtkf = vtkFiles;
-    *numFiles = numFields;
+    VTK_Free(output);
+    free(output);
 
-    return DX_SUCCESS;
+    if (job->stream)
+    {
+        pthread_mutex_lock(&(job->lock));
+        DX_ReleaseObject(job->dxf,job->fields[i]);
+        pthread_mutex_unlock(&(job->lock));
+    }
 }
 
 /**
@@ -554,31 +1743,145 @@ int dxFile2vtkDataFiles(dxFile *dxf, vtkDataFile ***vtkf, int * numFiles,char ty
 int main(int argc, char ** argv)
 {
     dxFile input;
-    vtkDataFile** output;
+    conversionJob job;
     char dxfilename[DX_MAX_FILENAME_LENGTH];
-    char vtkfilename[DX_MAX_FILENAME_LENGTH];
+    char type;
     int numFiles;
+    int numThreads;
+    int useIndex;
+    int stream;
+    size_t memoryBudget;
+    unsigned char compressor;
+    float *positions;
+    int opt;
     int i;
     int rc;
     
     numFiles = 0;
-    output = NULL;
+    numThreads = 1;
+    useIndex = 0;
+    stream = 0;
+    memoryBudget = VTK_MEMORY_BUDGET_DEFAULT;
+    compressor = VTK_COMPRESSOR_NONE;
+
+    while ((opt = getopt(argc,argv,"ij:m:sz:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                useIndex = 1;
+                break;
+            case 'j':
+                numThreads = atoi(optarg);
+                if (numThreads < 1)
+                {
+                    fprintf(stderr,USAGE);
+                    exit(1);
+                }
+                break;
+            case 'm':
+                if (atoi(optarg) < 1)
+                {
+                    fprintf(stderr,USAGE);
+                    exit(1);
+                }
+                memoryBudget = (size_t)atoi(optarg) << 20;
+                break;
+            case 's':
+                stream = 1;
+                break;
+            case 'z':
+                if (streq(optarg,"zlib"))
+                {
+                    compressor = VTK_COMPRESSOR_ZLIB;
+                }
+#ifdef VTK_HAVE_LZ4
+                else if (streq(optarg,"lz4"))
+                {
+                    compressor = VTK_COMPRESSOR_LZ4;
+                }
+#endif
+                else
+                {
+                    fprintf(stderr,"Error: compressor %s is not supported\n",optarg);
+                    exit(1);
+                }
+                break;
+            default:
+                fprintf(stderr,USAGE);
+                exit(1);
+        }
+    }
+    argc -= optind;
+    argv += optind;
     
-    if (argc < 3)
+    if (argc < 2)
+    {
+        fprintf(stderr,USAGE);
+        exit(1);
+    }
+
+    type = VTK_TYPE_DEFAULT;
+    if (argc == 3)
+    {
+        if (streq(argv[2],"ASCII"))
+        {
+            type = VTK_ASCII;
+        }
+        else if (streq(argv[2],"BINARY"))
+        {
+            type = VTK_BINARY;
+        }
+        else if (streq(argv[2],"XML"))
+        {
+            type = VTK_XML;
+        }
+        else
+        {
+            fprintf(stderr,USAGE);
+            exit(1);
+        }
+    }
+    if (compressor != VTK_COMPRESSOR_NONE && type != VTK_XML)
     {
-        fprintf(stderr,"Usage: dx2vtk filename.dx filename.vtk [ASCII | BINARY]\n");
+        fprintf(stderr,"Error: only XML output can be compressed\n");
         exit(1);
     }
 
-    strncpy(dxfilename,argv[1],DX_MAX_FILENAME_LENGTH);
-    if ((rc = DX_Open(&input,dxfilename)) != DX_SUCCESS)
+    strncpy(dxfilename,argv[0],DX_MAX_FILENAME_LENGTH);
+    if (useIndex)
+    {
+        rc = DX_OpenIndexed(&input,dxfilename);
+    }
+    else
+    {
+        rc = DX_Open(&input,dxfilename);
+    }
+    if (rc != DX_SUCCESS)
     {
         fprintf(stderr,"Error: Could not Open DX file [code: %d]\n",rc);
         exit(1);
     }
+    // external binary data is streamed from its file by the writer
+    input.deferExternal = 1;
 
 
-    if ((rc = DX_LoadAll(&input)) != DX_SUCCESS)
+    if (stream)
+    {
+        // only the series or group headers are needed up front
+        for (i=0;i<input.numObjects && rc == DX_SUCCESS;i++)
+        {
+            if (input.objs[i].class == DX_SERIES || input.objs[i].class == DX_GROUP)
+            {
+                rc = DX_LoadObject(&input,&(input.objs[i]),0);
+            }
+        }
+    }
+    else
+    {
+        rc = DX_LoadAll(&input);
+    }
+    if (rc != DX_SUCCESS)
     {
         fprintf(stderr,"Error: Could not Load DX file contents [code: %d]\n",rc);
         exit(1);
@@ -593,42 +1896,65 @@ printf(" num objects %d\n",input.numObjects);
     }
 #endif
 
-    DX_Close(&input);
+    if (!stream)
+    {
+        DX_Close(&input);
+    }
 
-    if (argc == 4)
+    rc = GetFieldObjects(&input,&(job.fields),&numFiles);
+    if (rc != DX_SUCCESS)
     {
-        if (streq(argv[3],"ASCII"))
-        {
-            // do conversion
-            rc = dxFile2vtkDataFiles(&input, &output, &numFiles,VTK_ASCII);
-        }
-        else if (streq(argv[3],"BINARY"))
-        {
-            rc = dxFile2vtkDataFiles(&input, &output, &numFiles,VTK_BINARY);
-        }
-        else
-        {
-            fprintf(stderr,"Usage: dx2vtk filename.dx filename.vtk [ASCII | BINARY]\n");
-            exit(1);
-        }
+        fprintf(stderr,"Error: Conversion failed [code %d]\n",rc);
+        exit(1);
     }
-    else
+
+    // each member is converted and written by one task
+    job.dxf = &input;
+    job.pattern = argv[1];
+    job.type = type;
+    // spare processors format the ASCII output of each member
+    job.formatThreads = GetNumProcessors()/numThreads;
+    if (job.formatThreads < 1)
     {
-        rc = dxFile2vtkDataFiles(&input, &output, &numFiles,VTK_TYPE_DEFAULT);
+        job.formatThreads = 1;
     }
-    if (rc != DX_SUCCESS)
+    // the budget is shared by the members converted at the same time
+    job.memoryBudget = memoryBudget/numThreads;
+    job.compressor = compressor;
+    job.stream = stream;
+    job.geometries = (sharedGeometry *)malloc(numFiles*sizeof(sharedGeometry));
+    job.numGeometries = 0;
+    if (job.geometries == NULL && numFiles > 0)
     {
-        fprintf(stderr,"Error: Conversion failed [code %d]\n",rc);
+        fprintf(stderr,"Error: Conversion failed [code %d]\n",DX_MEMORY_ERROR);
+        exit(1);
+    }
+    job.rc = DX_SUCCESS;
+    pthread_mutex_init(&(job.lock),NULL);
+    ParallelFor(numThreads,numFiles,ConvertFieldTask,&job);
+    pthread_mutex_destroy(&(job.lock));
+    FreeGeometries(&job);
+    free(job.fields);
+    if (stream)
+    {
+        DX_Close(&input);
+    }
+    if (job.rc != DX_SUCCESS)
+    {
+        fprintf(stderr,"Error: Conversion failed [code %d]\n",job.rc);
         exit(1);
     }
 
-    for (i=0;i<numFiles;i++)
+    // index the time steps of a series, so it opens as one dataset
+    positions = GetSeriesPositions(&input);
+    if (positions != NULL && strchr(job.pattern,'%') != NULL)
     {
-        sprintf(vtkfilename,argv[2],i);
-        VTK_Open(output[i],vtkfilename);
-        VTK_Write(output[i]);
-        VTK_Close(output[i]);
+        rc = WriteSeriesCollection(job.pattern,positions,numFiles);
+        if (rc != DX_SUCCESS)
+        {
+            fprintf(stderr,"Error: Could not write collection file [code %d]\n",rc);
+            exit(1);
+        }
     }
+    return 0;
 }
-
-
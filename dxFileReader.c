@@ -17,17 +17,20 @@
 
 #include "dxFileReader.h"
 
-char read_buf[DX_READ_BUFFER_SIZE];
-
 /**
  * @brief Opens an OpenDX file
- * @details reads through the file finding all objects and populating object descriptors. No data is actually loaded into memory.
+ * @details reads through the file finding all objects and populating object descriptors. No data is actually loaded into memory,
+ * data sections are skipped using the array header.
  * @param filename The name of the OpenDX file
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
 int DX_Open(dxFile *file, const char * filename)
 {
     int i;
+    int capacity;
+    const char *token;
+    size_t length;
+    dxCursor cur;
     // check the dxFile is valid
     if (file == NULL)
     {
@@ -43,50 +46,61 @@ int DX_Open(dxFile *file, const char * filename)
 
     strncpy((void*)(file->filename),(void *)filename,DX_MAX_FILENAME_LENGTH);
     
-    file->fp = fopen(file->filename,"r");
-    if (file->fp == NULL)
+    if (MapFile(&(file->map),file->filename) != 0)
     {
         return DX_FILE_NOT_FOUND_ERROR;
     }
+    cur.pos = 0;
+    file->numThreads = GetNumProcessors();
+    file->deferExternal = 0;
+    file->tableSize = 0;
+    file->nameTable = NULL;
+    file->numberTable = NULL;
 
 #ifdef DEBUG
     printf("Reading file [%s]...\n",file->filename);
 #endif
 
-    // first pass, coun the number of objects
+    // single pass, read object headers and skip over any data that follows
+    // them so the cost is proportional to the number of objects
     file->numObjects = 0;
-    while (NextToken(file->fp,read_buf,DX_READ_BUFFER_SIZE) == 0)
-    {
-        if (streq(read_buf,"object"))
-        {
-            file->numObjects++;
-        }
-    }
-
-#ifdef DEBUG
-    printf("File contains %d objects\n",file->numObjects);
-#endif
-
-    // second pass, read object headers
-    file->objs = (object *)malloc((file->numObjects)*sizeof(object));
+    capacity = DX_INITIAL_OBJECTS;
+    file->objs = (object *)malloc(capacity*sizeof(object));
     if (file->objs == NULL)
     {
         return DX_MEMORY_ERROR; 
     }
 
-    rewind(file->fp);
     i=0;
-    while (NextToken(file->fp,read_buf,DX_READ_BUFFER_SIZE) == 0)
+    while (MemNextToken(file->map.data,file->map.size,&(cur.pos),&token,&length) == 0)
     {
-        if (streq(read_buf,"object"))
+        if (spaneq(token,length,"object"))
         {
-            ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+            int rc;
+            if (i == capacity)
+            {
+                object *objs;
+                capacity *= 2;
+                objs = (object *)realloc(file->objs,capacity*sizeof(object));
+                if (objs == NULL)
+                {
+                    return DX_MEMORY_ERROR;
+                }
+                file->objs = objs;
+            }
+            file->objs[i].header = cur.pos;
+            ReadDXLine(file,&cur);
 #ifdef DEBUG
-            printf("HEADER %d %s\n",i,read_buf);
+            printf("HEADER %d %s\n",i,cur.line);
 #endif
             // get the cursor position
-            fgetpos(file->fp,&(file->objs[i].pos));
-            ParseObjectHeader(&(file->objs[i]),read_buf);
+            file->objs[i].pos = cur.pos;
+            file->objs[i].length = 0;
+            rc = ParseObjectHeader(&(file->objs[i]),cur.line);
+            if (rc != DX_SUCCESS)
+            {
+                return rc;
+            }
 #ifdef DEBUG
             printf("Class: %hhu\n",file->objs[i].class);
             printf("name: %s ,",file->objs[i].name);
@@ -112,9 +126,298 @@ int DX_Open(dxFile *file, const char * filename)
             }
 #endif
             i++;
+            file->numObjects = i;
+            rc = SkipArrayData(&(file->objs[i-1]),file,&cur);
+            if (rc != DX_SUCCESS)
+            {
+                return rc;
+            }
+            // data blocks are only read again when the object is loaded
+            ReleaseMappedRange(&(file->map),file->objs[i-1].pos,file->objs[i-1].pos + file->objs[i-1].length);
+        }
+        else if (spaneq(token,length,"end"))
+        {
+            // anything after end is data referenced by offset
+            break;
+        }
+        else if (spaneq(token,length,"attribute") || spaneq(token,length,"component") || spaneq(token,length,"member")
+                 || spaneq(token,length,"term"))
+        {
+            // these are loaded later, skip the line so quoted values are
+            // never mistaken for keywords
+            ReadDXLine(file,&cur);
+        }
+    }
+
+#ifdef DEBUG
+    printf("File contains %d objects\n",file->numObjects);
+#endif
+    return BuildObjectTable(file);
+}
+
+/**
+ * @brief Opens an OpenDX file using a sidecar index if possible
+ * @details If an index file exists next to the OpenDX file and matches its size
+ * and modification time, the object descriptors are loaded from the index and
+ * the OpenDX file itself is not scanned. Otherwise the file is opened with 
+ * DX_Open() and a new index is written for next time (failure to write the
+ * index is not an error).
+ * @param file the dxFile structure to populate
+ * @param filename The name of the OpenDX file
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int DX_OpenIndexed(dxFile *file, const char * filename)
+{
+    char indexname[DX_MAX_FILENAME_LENGTH];
+    int rc;
+    
+    GetIndexFilename(filename,indexname,DX_MAX_FILENAME_LENGTH);
+    if (DX_ReadIndex(file,filename,indexname) == DX_SUCCESS)
+    {
+        return DX_SUCCESS;
+    }
+
+    rc = DX_Open(file,filename);
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    DX_WriteIndex(file,indexname);
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief Gets the sidecar index filename for an OpenDX file
+ * @details a trailing .dx is replaced with .dxidx, otherwise .dxidx is appended.
+ * @param filename the OpenDX filename
+ * @param indexname the output buffer
+ * @param size the size of the output buffer
+ */
+void GetIndexFilename(const char *filename, char *indexname, int size)
+{
+    size_t n;
+    n = strlen(filename);
+    if (n >= 3 && streq(filename + n - 3,".dx"))
+    {
+        n -= 3;
+    }
+    snprintf(indexname,size,"%.*s%s",(int)n,filename,DX_INDEX_EXTENSION);
+}
+
+/**
+ * @brief writes the sidecar index of an open OpenDX file
+ * @details The index records the size and modification time of the OpenDX file
+ * followed by one line per object giving the offsets of the start and end of 
+ * its header, the length of its inline data and the header text itself. The index is 
+ * written to a temporary file first and then renamed, so readers never see a
+ * partial index.
+ * @param file an open dxFile
+ * @param indexname the index filename
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int DX_WriteIndex(dxFile *file, const char *indexname)
+{
+    struct stat st;
+    char tmpname[DX_MAX_FILENAME_LENGTH+8];
+    char line[DX_READ_BUFFER_SIZE];
+    FILE *fp;
+    int i;
+    int rc;
+
+    if (stat(file->filename,&st) != 0)
+    {
+        return DX_FILE_NOT_FOUND_ERROR;
+    }
+
+    snprintf(tmpname,sizeof(tmpname),"%s.%d",indexname,(int)getpid());
+    fp = fopen(tmpname,"w");
+    if (fp == NULL)
+    {
+        return DX_FILE_NOT_FOUND_ERROR;
+    }
+
+    fprintf(fp,"%s %d\n",DX_INDEX_MAGIC,DX_INDEX_VERSION);
+    fprintf(fp,"size %lld mtime %lld %ld objects %d\n",(long long)st.st_size,
+        (long long)st.st_mtim.tv_sec,(long)st.st_mtim.tv_nsec,file->numObjects);
+    for (i=0;i<(file->numObjects);i++)
+    {
+        size_t pos;
+        pos = file->objs[i].header;
+        MemReadLine(file->map.data,file->map.size,&pos,line,DX_READ_BUFFER_SIZE);
+        fprintf(fp,"%zu %zu %zu %s\n",file->objs[i].header,file->objs[i].pos,file->objs[i].length,line);
+    }
+
+    rc = ferror(fp);
+    if (fclose(fp) != 0 || rc != 0 || rename(tmpname,indexname) != 0)
+    {
+        remove(tmpname);
+        return DX_INVALID_FILE_ERROR;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief opens an OpenDX file using the object descriptors from its index
+ * @param file the dxFile structure to populate
+ * @param filename The name of the OpenDX file
+ * @param indexname The name of the index file
+ * @returns DX_SUCCESS on compeletion, or an error if the index does not 
+ * exist, is out of date or is invalid
+ */
+int DX_ReadIndex(dxFile *file, const char *filename, const char *indexname)
+{
+    struct stat st;
+    mappedFile idx;
+    size_t pos;
+    char line[DX_READ_BUFFER_SIZE];
+    char magic[DX_MAX_TOKEN_LENGTH];
+    int version;
+    long long size;
+    long long sec;
+    long nsec;
+    int i,j;
+    int rc;
+
+    if (file == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    if (stat(filename,&st) != 0)
+    {
+        return DX_FILE_NOT_FOUND_ERROR;
+    }
+    if (MapFile(&idx,indexname) != 0)
+    {
+        return DX_FILE_NOT_FOUND_ERROR;
+    }
+
+    // validate against the OpenDX file
+    pos = 0;
+    rc = DX_INVALID_FILE_ERROR;
+    MemReadLine(idx.data,idx.size,&pos,line,DX_READ_BUFFER_SIZE);
+    if (sscanf(line,"%31s %d",magic,&version) != 2 || !streq(magic,DX_INDEX_MAGIC) || version != DX_INDEX_VERSION)
+    {
+        UnmapFile(&idx);
+        return rc;
+    }
+    MemReadLine(idx.data,idx.size,&pos,line,DX_READ_BUFFER_SIZE);
+    if (sscanf(line,"size %lld mtime %lld %ld objects %d",&size,&sec,&nsec,&(file->numObjects)) != 4
+        || size != (long long)st.st_size || sec != (long long)st.st_mtim.tv_sec || nsec != (long)st.st_mtim.tv_nsec
+        || file->numObjects < 0)
+    {
+        UnmapFile(&idx);
+        return rc;
+    }
+
+    // from here on failures release what was read, see fail below
+    i = 0;
+    file->filename = (char*)malloc(DX_MAX_FILENAME_LENGTH*sizeof(char));
+    file->objs = (object *)malloc((file->numObjects > 0 ? file->numObjects : 1)*sizeof(object));
+    if (file->filename == NULL || file->objs == NULL)
+    {
+        UnmapFile(&idx);
+        rc = DX_MEMORY_ERROR;
+        goto fail;
+    }
+    strncpy((void*)(file->filename),(void *)filename,DX_MAX_FILENAME_LENGTH);
+
+    for (i=0;i<(file->numObjects);i++)
+    {
+        char *header;
+        if (MemReadLine(idx.data,idx.size,&pos,line,DX_READ_BUFFER_SIZE) != 0 && line[0] == '\0')
+        {
+            break;
+        }
+        file->objs[i].header = (size_t)strtoull(line,&header,10);
+        file->objs[i].pos = (size_t)strtoull(header,&header,10);
+        file->objs[i].length = (size_t)strtoull(header,&header,10);
+        file->objs[i].obj = NULL;
+        if (file->objs[i].pos + file->objs[i].length > (size_t)st.st_size 
+            || ParseObjectHeader(&(file->objs[i]),header) != DX_SUCCESS)
+        {
+            break;
         }
+    }
+    UnmapFile(&idx);
+    if (i != file->numObjects)
+    {
+        goto fail;
+    }
+
+    if (MapFile(&(file->map),file->filename) != 0)
+    {
+        rc = DX_FILE_NOT_FOUND_ERROR;
+        goto fail;
+    }
+    file->numThreads = GetNumProcessors();
+    file->deferExternal = 0;
+    rc = BuildObjectTable(file);
+    if (rc == DX_SUCCESS)
+    {
+        return DX_SUCCESS;
+    }
+    UnmapFile(&(file->map));
+    free(file->nameTable);
+    free(file->numberTable);
+    file->nameTable = NULL;
+    file->numberTable = NULL;
+
+fail:
+    // the first i headers were parsed, a failed one allocates nothing
+    for (j=0;j<i;j++)
+    {
+        FreeObjectHeader(&(file->objs[j]));
+    }
+    free(file->objs);
+    free(file->filename);
+    file->objs = NULL;
+    file->filename = NULL;
+    file->numObjects = 0;
+    return rc;
+}
+
+/**
+ * @brief moves the file cursor past the data section of an object
+ * @details Only arrays with data mode follows have an inline data section,
+ * which holds a single item for a constant array. For text data the expected
+ * number of values are skipped without being converted, for binary data the
+ * cursor is moved by the byte length.
+ * @param obj the object whose header has just been read
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
+ * after the object header.
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int SkipArrayData(object *obj, dxFile *file, dxCursor *cur)
+{
+    array *header;
+    size_t size;
+
+    if (obj->class != DX_ARRAY && obj->class != DX_CONSTANTARRAY)
+    {
+        return DX_SUCCESS;
+    }
 
+    header = (array *)(obj->obj);
+    if (header->dataMode != DX_FOLLOWS)
+    {
+        return DX_SUCCESS;
+    }
+    
+    size = (obj->class == DX_CONSTANTARRAY) ? GetItemSize(header) : GetArraySize(header);
+    if (header->dataType == DX_BINARY || header->dataType == DX_IEEE)
+    {
+        if (cur->pos + size*GetTypeSize(header->type) > file->map.size)
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+        cur->pos += size*GetTypeSize(header->type);
+    }
+    else if (MemSkipTokens(file->map.data,file->map.size,&(cur->pos),size) != 0)
+    {
+        return DX_INVALID_FILE_ERROR;
     }
+    obj->length = cur->pos - obj->pos;
     return DX_SUCCESS;
 }
 
@@ -130,8 +433,7 @@ int DX_Reopen(dxFile *file)
     {
         return DX_MEMORY_ERROR;
     }
-    file->fp = fopen(file->filename,"r");
-    if (file->fp == NULL)
+    if (MapFile(&(file->map),file->filename) != 0)
     {
         return DX_FILE_NOT_FOUND_ERROR;
     }
@@ -152,7 +454,8 @@ int DX_Close(dxFile *file)
     {
         return DX_MEMORY_ERROR;
     }
-    fclose(file->fp);
+    UnmapFile(&(file->map));
+    return DX_SUCCESS;
 }
 
 /**
@@ -166,6 +469,7 @@ int DX_LoadAll(dxFile *file)
 {
     int i;
     int rc;
+    dxCursor cur;
     for (i=0;i<(file->numObjects);i++)
     {
         if (file->objs[i].isLoaded == 0)
@@ -173,14 +477,14 @@ int DX_LoadAll(dxFile *file)
 #ifdef DEBUG
             printf("Reading class %d named %s\n",i,file->objs[i].name);
 #endif
-            fsetpos(file->fp,&(file->objs[i].pos));
+            cur.pos = file->objs[i].pos;
 
-            rc = LoadObjectData(&(file->objs[i]),file);
+            rc = LoadObjectData(&(file->objs[i]),file,&cur);
             if (rc != DX_SUCCESS)
             {
                 return rc;
             }
-            rc = LoadAttributes(&(file->objs[i]),file);
+            rc = LoadAttributes(&(file->objs[i]),file,&cur);
             if (rc != DX_SUCCESS)
             {
                 return rc;
@@ -201,96 +505,409 @@ int DX_LoadAll(dxFile *file)
 }
 
 /**
- * @brief Parses an object header
- * @details This just tests what type of object it is and differs to an
- * object specific parser. On successful execution, the object header 
- * information will be set.
- * @param obj a pointer to an object wrapper
- * @param header the header text line
- * @returns DX_SUCCESS or an appropiate error code
+ * @brief loads a single object into memory
+ * @details This allows random access, e.g., to a single member of a series,
+ * without loading the rest of the file. 
+ * @param file the file to load data from
+ * @param obj the object to load
+ * @param recursive if non-zero, the components of fields and the members of
+ * groups and series are also loaded
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
-int ParseObjectHeader(object *obj, char* header)
+int DX_LoadObject(dxFile *file, object *obj, int recursive)
 {
-    //determine type and defer to a sub-function
-    char name[DX_MAX_TOKEN_LENGTH];
-    char buffer[DX_MAX_TOKEN_LENGTH];
-    char *ptr;
+    int i;
     int rc;
-    unsigned char state;
-   
-    // object name/id
-    StringToken(header,buffer,DX_MAX_TOKEN_LENGTH);
-    strncpy(name,buffer,DX_MAX_TOKEN_LENGTH);
-    obj->number = atoi(name);
-    strncpy(obj->name,name,DX_MAX_TOKEN_LENGTH);
-    // next token must be class
-    StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
-    if (!streq(buffer,"class"))
-    {
-        return DX_INVALID_FILE_ERROR;    
-    }
-    // get the class type
-    ptr = StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
-    if (streq(buffer,"array"))
-    {
-        obj->class = DX_ARRAY;
-        ParseArrayObjectHeader(obj,ptr);
-    }
-    else if (streq(buffer,"field"))
-    {
-        obj->class = DX_FIELD;
-        ParseFieldObjectHeader(obj,ptr);
-    }
-    else if (streq(buffer,"group"))
-    {
-        obj->class = DX_GROUP;
-        ParseGroupObjectHeader(obj,ptr);
-    }
-    else if (streq(buffer,"gridpositions"))
-    {
-        obj->class = DX_GRIDPOSITIONS;
-        ParseGridPositionsObjectHeader(obj,ptr);
-    }
-    else if (streq(buffer,"gridconnections"))
+    if (obj->isLoaded == 0)
     {
-        obj->class = DX_GRIDCONNECTIONS;
-        ParseGridConnectionsObjectHeader(obj,ptr);
+        dxCursor cur;
+        cur.pos = obj->pos;
+        rc = LoadObjectData(obj,file,&cur);
+        if (rc != DX_SUCCESS)
+        {
+            return rc;
+        }
+        rc = LoadAttributes(obj,file,&cur);
+        if (rc != DX_SUCCESS)
+        {
+            return rc;
+        }
     }
-    else if (streq(buffer,"series"))
+
+    if (!recursive)
     {
-        obj->class = DX_SERIES;
-        ParseSeriesObjectHeader(obj,ptr);
+        return DX_SUCCESS;
     }
-    else
+
+    switch (obj->class)
     {
-        return DX_INVALID_FILE_ERROR;
+        case DX_FIELD:
+        {
+            field *fld = (field *)(obj->obj);
+            for (i=0;i<(fld->numComponents);i++)
+            {
+                rc = DX_LoadObject(file,fld->components[i],recursive);
+                if (rc != DX_SUCCESS)
+                {
+                    return rc;
+                }
+            }
+        }
+            break;
+        case DX_GROUP:
+        {
+            group *grp = (group *)(obj->obj);
+            for (i=0;i<(grp->numMembers);i++)
+            {
+                rc = DX_LoadObject(file,grp->members[i],recursive);
+                if (rc != DX_SUCCESS)
+                {
+                    return rc;
+                }
+            }
+        }
+            break;
+        case DX_SERIES:
+        {
+            series *ser = (series *)(obj->obj);
+            for (i=0;i<(ser->numMembers);i++)
+            {
+                rc = DX_LoadObject(file,ser->members[i],recursive);
+                if (rc != DX_SUCCESS)
+                {
+                    return rc;
+                }
+            }
+        }
+            break;
     }
-
     return DX_SUCCESS;
 }
 
 /**
- * @brief Parses a field object header
- * @param obj a pointer to the object wrapper that will hold this field
- * @param header the pointer to header line starting from type
- * @returns DX_SUCCESS if successfully complete, otherwise an appropriate
- * error code
+ * @brief gets the objects referenced by a loaded field, group, series, 
+ * product array or mesh array
+ * @param obj the object
+ * @param refs output pointer to the array of references
+ * @returns the number of references
  */
-int ParseFieldObjectHeader(object *obj,char *header)
+int GetObjectReferences(object *obj, object ***refs)
 {
-    field * data;
-
-    if (obj->class != DX_FIELD)
+    *refs = NULL;
+    if (obj->isLoaded == 0)
     {
-        return DX_INVALID_USAGE_ERROR; 
+        return 0;
     }
-
-    data = (field *)malloc(sizeof(field));
-    
-    if (data == NULL)
+    switch (obj->class)
+    {
+        case DX_FIELD:
+            *refs = ((field *)(obj->obj))->components;
+            return ((field *)(obj->obj))->numComponents;
+        case DX_GROUP:
+            *refs = ((group *)(obj->obj))->members;
+            return ((group *)(obj->obj))->numMembers;
+        case DX_SERIES:
+            *refs = ((series *)(obj->obj))->members;
+            return ((series *)(obj->obj))->numMembers;
+        case DX_PRODUCTARRAY:
+        case DX_MESHARRAY:
+            *refs = ((array *)(obj->obj))->terms;
+            return ((array *)(obj->obj))->numTerms;
+    }
+    return 0;
+}
+
+/**
+ * @brief frees the data loaded for a single object
+ * @details The header information is kept so the object can be loaded again
+ * with DX_LoadObject(). Referenced objects are not unloaded.
+ * @param file the file the object belongs to
+ * @param obj the object to unload
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int DX_UnloadObject(dxFile *file, object *obj)
+{
+    if (file == NULL || obj == NULL)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+    if (obj->isLoaded == 0)
+    {
+        return DX_SUCCESS;
+    }
+
+    switch (obj->class)
+    {
+        case DX_ARRAY:
+            free(((array *)(obj->obj))->data);
+            ((array *)(obj->obj))->data = NULL;
+            // the parsed text or binary block is not needed again soon
+            ReleaseMappedRange(&(file->map),obj->pos,obj->pos + obj->length);
+            break;
+        case DX_FIELD:
+            free(((field *)(obj->obj))->components);
+            ((field *)(obj->obj))->components = NULL;
+            free(((field *)(obj->obj))->aliases);
+            ((field *)(obj->obj))->aliases = NULL;
+            break;
+        case DX_GROUP:
+            free(((group *)(obj->obj))->members);
+            ((group *)(obj->obj))->members = NULL;
+            break;
+        case DX_SERIES:
+            free(((series *)(obj->obj))->members);
+            free(((series *)(obj->obj))->positions);
+            ((series *)(obj->obj))->members = NULL;
+            ((series *)(obj->obj))->positions = NULL;
+            break;
+        case DX_CONSTANTARRAY:
+        case DX_REGULARARRAY:
+        case DX_PATHARRAY:
+        case DX_PRODUCTARRAY:
+        case DX_MESHARRAY:
+        {
+            array *header = (array *)(obj->obj);
+            free(header->origin);
+            free(header->delta);
+            free(header->terms);
+            header->origin = NULL;
+            header->delta = NULL;
+            header->terms = NULL;
+        }
+            break;
+    }
+    free(obj->attributes);
+    obj->attributes = NULL;
+    obj->numAttributes = 0;
+    obj->isLoaded = 0;
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief frees the class instance parsed from an object header
+ * @details The object must not be loaded, see DX_UnloadObject().
+ * @param obj the object
+ */
+void FreeObjectHeader(object *obj)
+{
+    if (obj->obj == NULL)
+    {
+        return;
+    }
+    switch (obj->class)
+    {
+        case DX_GRIDPOSITIONS:
+            free(((gridpositions *)(obj->obj))->counts);
+            free(((gridpositions *)(obj->obj))->origin);
+            free(((gridpositions *)(obj->obj))->deltas);
+            break;
+        case DX_GRIDCONNECTIONS:
+            free(((gridconnections *)(obj->obj))->counts);
+            break;
+    }
+    free(obj->obj);
+    obj->obj = NULL;
+}
+
+/**
+ * @brief loads an object and everything it references, counting references
+ * @details Each call increments the reference count of the object and of
+ * every object it references, objects are loaded when their count leaves 
+ * zero. Paired with DX_ReleaseObject() this keeps only the objects in use
+ * in memory, e.g., one member of a series at a time.
+ * @param file the file to load data from
+ * @param obj the object to acquire
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ * @note Calls on the same dxFile must not run concurrently.
+ */
+int DX_AcquireObject(dxFile *file, object *obj)
+{
+    int i;
+    int n;
+    int rc;
+    object **refs;
+
+    if (obj->refCount == 0 && obj->isLoaded == 0)
+    {
+        rc = DX_LoadObject(file,obj,0);
+        if (rc != DX_SUCCESS)
+        {
+            return rc;
+        }
+    }
+    obj->refCount++;
+
+    n = GetObjectReferences(obj,&refs);
+    for (i=0;i<n;i++)
+    {
+        rc = DX_AcquireObject(file,refs[i]);
+        if (rc != DX_SUCCESS)
+        {
+            return rc;
+        }
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief releases an object acquired with DX_AcquireObject()
+ * @details Decrements the reference counts of the object and everything it
+ * references, objects are unloaded when their count reaches zero.
+ * @param file the file the object belongs to
+ * @param obj the object to release
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ * @note Calls on the same dxFile must not run concurrently.
+ */
+int DX_ReleaseObject(dxFile *file, object *obj)
+{
+    int i;
+    int n;
+    object **refs;
+
+    if (obj->refCount <= 0)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+
+    n = GetObjectReferences(obj,&refs);
+    for (i=0;i<n;i++)
+    {
+        DX_ReleaseObject(file,refs[i]);
+    }
+
+    obj->refCount--;
+    if (obj->refCount == 0)
+    {
+        return DX_UnloadObject(file,obj);
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief Parses an object header
+ * @details This just tests what type of object it is and differs to an
+ * object specific parser. On successful execution, the object header 
+ * information will be set.
+ * @param obj a pointer to an object wrapper
+ * @param header the header text line
+ * @returns DX_SUCCESS or an appropiate error code
+ */
+int ParseObjectHeader(object *obj, char* header)
+{
+    char *save;
+    //determine type and defer to a sub-function
+    char name[DX_MAX_TOKEN_LENGTH];
+    char buffer[DX_MAX_TOKEN_LENGTH];
+    char *ptr;
+    int rc;
+    unsigned char state;
+   
+    obj->refCount = 0;
+    obj->numAttributes = 0;
+    obj->attributes = NULL;
+
+    // object name/id
+    StringTokenR(header,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    strncpy(name,buffer,DX_MAX_TOKEN_LENGTH);
+    // only objects with a number for a name can be referenced by number
+    obj->number = (name[0] != '\0' && name[strspn(name,"0123456789")] == '\0') ? atoi(name) : -1;
+    strncpy(obj->name,name,DX_MAX_TOKEN_LENGTH);
+    // next token must be class
+    StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    if (!streq(buffer,"class"))
+    {
+        return DX_INVALID_FILE_ERROR;    
+    }
+    // get the class type
+    ptr = StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    if (streq(buffer,"array"))
+    {
+        obj->class = DX_ARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"field"))
+    {
+        obj->class = DX_FIELD;
+        ParseFieldObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"group"))
+    {
+        obj->class = DX_GROUP;
+        ParseGroupObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"gridpositions"))
+    {
+        obj->class = DX_GRIDPOSITIONS;
+        ParseGridPositionsObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"gridconnections"))
+    {
+        obj->class = DX_GRIDCONNECTIONS;
+        ParseGridConnectionsObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"series"))
+    {
+        obj->class = DX_SERIES;
+        ParseSeriesObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"constantarray"))
+    {
+        obj->class = DX_CONSTANTARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"regulararray"))
+    {
+        obj->class = DX_REGULARARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"patharray"))
+    {
+        obj->class = DX_PATHARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"productarray"))
+    {
+        obj->class = DX_PRODUCTARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else if (streq(buffer,"mesharray"))
+    {
+        obj->class = DX_MESHARRAY;
+        ParseArrayObjectHeader(obj,ptr);
+    }
+    else
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief Parses a field object header
+ * @param obj a pointer to the object wrapper that will hold this field
+ * @param header the pointer to header line starting from type
+ * @returns DX_SUCCESS if successfully complete, otherwise an appropriate
+ * error code
+ */
+int ParseFieldObjectHeader(object *obj,char *header)
+{
+    field * data;
+
+    if (obj->class != DX_FIELD)
+    {
+        return DX_INVALID_USAGE_ERROR; 
+    }
+
+    data = (field *)malloc(sizeof(field));
+    
+    if (data == NULL)
     {
         return DX_MEMORY_ERROR;
     }
+    data->numComponents = 0;
+    data->components = NULL;
+    data->aliases = NULL;
 
     obj->obj = (void*)data;
     obj->isLoaded = 0;
@@ -327,6 +944,10 @@ int ParseGroupObjectHeader(object *obj,char *header)
 
 /**
  * @brief Parses an array object header
+ * @details Also parses the headers of the implicit array classes, which have
+ * no data section (except for the single item of a constant array). Their
+ * type defaults to float, a path array is a list of int pairs, and the 
+ * items of product and mesh arrays are known once their terms are loaded.
  * @param obj a pointer to the object wrapper that will hold this array
  * @param header the pointer to header line starting from type
  * @returns DX_SUCCESS if successfully complete, otherwise an appropriate
@@ -334,10 +955,11 @@ int ParseGroupObjectHeader(object *obj,char *header)
  */
 int ParseArrayObjectHeader(object *obj,char *header)
 {
+    char *save;
     char buffer[DX_MAX_TOKEN_LENGTH];
     array *data;
 
-    if (obj->class != DX_ARRAY)
+    if (!IsArrayObject(obj))
     {
         return DX_INVALID_USAGE_ERROR; 
     }
@@ -347,13 +969,19 @@ int ParseArrayObjectHeader(object *obj,char *header)
     {
         return DX_MEMORY_ERROR; 
     }
+    memset((void *)data,0,sizeof(array));
+    data->dataType = DX_TEXT;
+    if (obj->class != DX_ARRAY)
+    {
+        data->type = DX_FLOAT;
+    }
 
-    StringToken(header,buffer,DX_MAX_TOKEN_LENGTH);
+    StringTokenR(header,buffer,DX_MAX_TOKEN_LENGTH,&save);
     do 
     {
         if (streq(buffer,"type"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             // TODO: extend as needed
             if (streq(buffer,"float"))
             {
@@ -366,7 +994,7 @@ int ParseArrayObjectHeader(object *obj,char *header)
         }
         else if (streq(buffer,"category"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             if (streq(buffer,"real"))
             {
                 data->category = DX_REAL;
@@ -378,7 +1006,7 @@ int ParseArrayObjectHeader(object *obj,char *header)
         }
         else if (streq(buffer,"rank"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             data->rank = atoi(buffer);
         }
         else if (streq(buffer,"shape"))
@@ -386,18 +1014,19 @@ int ParseArrayObjectHeader(object *obj,char *header)
             int i;
             for (i=0;i<(data->rank);i++)
             {
-                StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+                StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
                 data->shape[i] = atoi(buffer);
             }
         }
-        else if (streq(buffer,"items"))
+        else if (streq(buffer,"items") || streq(buffer,"count"))
         {
+            char *ptr;
             // read the number of items
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             data->items = atoi(buffer);
 
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
-            while (!streq(buffer,"data"))
+            ptr = StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+            while (ptr != NULL && !streq(buffer,"data"))
             {
                 if (streq(buffer,"lsb"))
                 {
@@ -423,20 +1052,25 @@ int ParseArrayObjectHeader(object *obj,char *header)
                 {
                     data->dataType = DX_ASCII; 
                 }
-                StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+                ptr = StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+            }
+            // implicit arrays have no data section
+            if (ptr == NULL)
+            {
+                break;
             }
             // now we extract the data mode
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             if (streq(buffer,"mode"))
             {
-                StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+                StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
             }
 
             if (streq(buffer,"file"))
             {
                 int i;
                 data->dataMode = DX_FILE;
-                StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+                StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
                 // @todo strip buffer into a filename and offset
                 for (i=0;i<DX_MAX_TOKEN_LENGTH;i++)
                 {
@@ -461,7 +1095,16 @@ int ParseArrayObjectHeader(object *obj,char *header)
             }
         }
             
-    } while(StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH) != NULL);
+    } while(StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save) != NULL);
+
+    // a path of count positions has count - 1 segments
+    if (obj->class == DX_PATHARRAY)
+    {
+        data->type = DX_INT;
+        data->rank = 1;
+        data->shape[0] = 2;
+        data->items = (data->items > 0) ? data->items - 1 : 0;
+    }
 
     obj->obj = (void *)data;
     obj->isLoaded = 0;
@@ -477,6 +1120,7 @@ int ParseArrayObjectHeader(object *obj,char *header)
  */
 int ParseGridPositionsObjectHeader(object *obj, char *header)
 {
+    char *save;
     char buffer[DX_MAX_TOKEN_LENGTH];
     int temp_counts[DX_MAX_MESH_DIMENSIONS];
     gridpositions *data;
@@ -495,7 +1139,7 @@ int ParseGridPositionsObjectHeader(object *obj, char *header)
     }
 
     data->numCounts = -1;
-    StringToken(header,buffer,DX_MAX_TOKEN_LENGTH);
+    StringTokenR(header,buffer,DX_MAX_TOKEN_LENGTH,&save);
     // @note I hate the way OpenDX does not tell you the number of dimensions...
     // hard coding a limit seems so hacky and dirty... but for now it'll do...
     do 
@@ -509,7 +1153,7 @@ int ParseGridPositionsObjectHeader(object *obj, char *header)
             temp_counts[data->numCounts] = atoi(buffer);
             data->numCounts++;
         }
-    } while (StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH));
+    } while (StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save));
 
     if (data->numCounts == -1)
     {
@@ -550,6 +1194,7 @@ int ParseGridPositionsObjectHeader(object *obj, char *header)
  */
 int ParseGridConnectionsObjectHeader(object *obj, char *header)
 {
+    char *save;
     char buffer[DX_MAX_TOKEN_LENGTH];
     int temp_counts[DX_MAX_MESH_DIMENSIONS];
     gridconnections *data;
@@ -568,7 +1213,7 @@ int ParseGridConnectionsObjectHeader(object *obj, char *header)
     }
 
     data->numCounts = -1;
-    StringToken(header,buffer,DX_MAX_TOKEN_LENGTH);
+    StringTokenR(header,buffer,DX_MAX_TOKEN_LENGTH,&save);
     do 
     {
 #ifdef DEBUG
@@ -587,7 +1232,7 @@ int ParseGridConnectionsObjectHeader(object *obj, char *header)
         {
             return DX_NOT_SUPPORTED_ERROR;
         }
-    } while (StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH));
+    } while (StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save));
 
     if (data->numCounts == -1)
     {
@@ -643,31 +1288,48 @@ int ParseSeriesObjectHeader(object *obj, char *header)
  * and asserts isLoaded flag.
  * @param obj a pointer to the object to load
  * @param file the dxFile to load from
+ * @param cur the read cursor, located just after the object header
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
-int LoadObjectData(object *obj,dxFile * file)
+int LoadObjectData(object *obj, dxFile *file, dxCursor *cur)
 {
     int rc;
     // load data from file
     switch(obj->class)
     {
         case DX_ARRAY:
-            rc = LoadArrayData(obj,file);
+            rc = LoadArrayData(obj,file,cur);
             break;
         case DX_FIELD:
-            rc = LoadFieldData(obj,file);
+            rc = LoadFieldData(obj,file,cur);
             break;
         case DX_GROUP:
-            rc = LoadGroupData(obj,file);
+            rc = LoadGroupData(obj,file,cur);
             break;
         case DX_GRIDPOSITIONS:
-            rc = LoadGridPositionsData(obj,file);
+            rc = LoadGridPositionsData(obj,file,cur);
             break;
         case DX_GRIDCONNECTIONS:
-            rc = LoadGridConnectionsData(obj,file);
+            rc = LoadGridConnectionsData(obj,file,cur);
             break;
         case DX_SERIES:
-            rc = LoadSeriesData(obj,file);
+            rc = LoadSeriesData(obj,file,cur);
+            break;
+        case DX_CONSTANTARRAY:
+            rc = LoadConstantArrayData(obj,file,cur);
+            break;
+        case DX_REGULARARRAY:
+            rc = LoadRegularArrayData(obj,file,cur);
+            break;
+        case DX_PATHARRAY:
+            rc = DX_SUCCESS;
+            break;
+        case DX_PRODUCTARRAY:
+        case DX_MESHARRAY:
+            rc = LoadTermsData(obj,file,cur);
+            break;
+        default:
+            rc = DX_NOT_SUPPORTED_ERROR;
             break;
     }
 
@@ -682,17 +1344,21 @@ int LoadObjectData(object *obj,dxFile * file)
 
 /**
  * @brief load field data
- * @details locates the components it the object array, assigns an alias
- * to each and stores the pointer to associate the objects with the field.
+ * @details locates the components it the object array, stores the alias
+ * of each in the field and the pointer to associate the objects with the 
+ * field. Component objects are not written, as they may be shared with
+ * other fields.
  * @param obj the object pointer which wraps the field.
- * @param file the dxFile structure, assumes the stream cursor is located just
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
  * after the field header.
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  * @note This loader assumes all references are in the same dx file
  */
-int LoadFieldData(object *obj, dxFile *file)
+int LoadFieldData(object *obj, dxFile *file, dxCursor *cur)
 {
-    fpos_t pos;
+    char *save;
+    size_t pos;
     int i,j;
     field *data;
     char buffer[DX_MAX_TOKEN_LENGTH];
@@ -708,26 +1374,27 @@ int LoadFieldData(object *obj, dxFile *file)
     data->numComponents = 0;
 
     // count number of components and return start
-    fgetpos(file->fp,&pos);
-    ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+    pos = cur->pos;
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     while(streq(buffer,"component"))
     {
         data->numComponents++;
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+        ReadDXLine(file,cur);
 #ifdef DEBUG
-        printf("%s\n",read_buf);
+        printf("%s\n",cur->line);
 #endif
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
-    fsetpos(file->fp,&pos);
+    cur->pos = pos;
 
 #ifdef DEBUG
     printf("num comp: %d\n",data->numComponents);
 #endif
     // allocate memory for the component pointers
     data->components = (object **)malloc((data->numComponents)*sizeof(object *));
-    if (data->components == NULL)
+    data->aliases = malloc((data->numComponents)*sizeof(*(data->aliases)));
+    if (data->components == NULL || data->aliases == NULL)
     {
         return DX_MEMORY_ERROR;
     }
@@ -741,16 +1408,16 @@ int LoadFieldData(object *obj, dxFile *file)
     for (i=0;i<(data->numComponents);i++)
     {
         // read the line
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+        ReadDXLine(file,cur);
         // read component
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
         // get component alias
-        StringToken(NULL,alias,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,alias,DX_MAX_TOKEN_LENGTH,&save);
         // read reference
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         if (streq(buffer,"value"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         }
         strncpy(ref,buffer,DX_MAX_TOKEN_LENGTH);
         
@@ -762,7 +1429,7 @@ int LoadFieldData(object *obj, dxFile *file)
             return DX_INVALID_FILE_ERROR;
         }
 
-        strncpy(data->components[i]->alias,alias,DX_MAX_TOKEN_LENGTH);
+        strncpy(data->aliases[i],alias,DX_MAX_TOKEN_LENGTH);
     }
 
     return DX_SUCCESS;
@@ -773,13 +1440,15 @@ int LoadFieldData(object *obj, dxFile *file)
  * @details locates the members it the object array, assigns an alias
  * to each and stores the pointer to associate the objects with the group.
  * @param obj the object pointer which wraps the group.
- * @param file the dxFile structure, assumes the stream cursor is located just
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
  * after the group header.
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
-int LoadGroupData(object *obj,dxFile *file)
+int LoadGroupData(object *obj, dxFile *file, dxCursor *cur)
 {    
-    fpos_t pos;
+    char *save;
+    size_t pos;
     int i,j;
     group *data;
     char buffer[DX_MAX_TOKEN_LENGTH];
@@ -795,16 +1464,16 @@ int LoadGroupData(object *obj,dxFile *file)
     data->numMembers = 0;
 
     // count number of members and return start
-    fgetpos(file->fp,&pos);
-    ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+    pos = cur->pos;
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     while(streq(buffer,"member"))
     {
         data->numMembers++;
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
-    fsetpos(file->fp,&pos);
+    cur->pos = pos;
 
     // allocate memory for the member pointers
     data->members = (object **)malloc((data->numMembers)*sizeof(object *));
@@ -822,16 +1491,16 @@ int LoadGroupData(object *obj,dxFile *file)
     for (i=0;i<(data->numMembers);i++)
     {
         // read the line
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+        ReadDXLine(file,cur);
         // read member
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
         // get member alias
-        StringToken(NULL,alias,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,alias,DX_MAX_TOKEN_LENGTH,&save);
         // read reference
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         if (streq(buffer,"value"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         }
         strncpy(ref,buffer,DX_MAX_TOKEN_LENGTH);
         
@@ -854,12 +1523,13 @@ int LoadGroupData(object *obj,dxFile *file)
  * @brief loads array data
  * @details allocates memory and loads data array into memory
  * @param obj the pointer which wraps the array object
- * @param file the dxFile structure, assumes the stream cursor is located just
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
  * after the array header.
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  * @todo Currently only supports data mode follows
  */
-int LoadArrayData(object *obj,dxFile *file)
+int LoadArrayData(object *obj, dxFile *file, dxCursor *cur)
 {
     size_t size;
     int i;
@@ -867,223 +1537,948 @@ int LoadArrayData(object *obj,dxFile *file)
 
     if (obj->class != DX_ARRAY)
     {
-        return DX_INVALID_USAGE_ERROR;
+        return DX_INVALID_USAGE_ERROR;
+    }
+
+    header = (array *)(obj->obj);
+    size = 1;
+    for (i=0;i<(header->rank);i++)
+    {
+        size *= (header->shape[i]);
+    }
+    
+    switch(header->dataMode)
+    {
+        default:
+        case DX_FOLLOWS:
+            if (header->dataType == DX_BINARY || header->dataType == DX_IEEE)
+            {
+                size_t n;
+                header->data = malloc(GetArraySize(header)*GetTypeSize(header->type));
+                if (header->data == NULL)
+                {
+                    return DX_MEMORY_ERROR;
+                }
+                n = GetArraySize(header)*GetTypeSize(header->type);
+                if (cur->pos + n > file->map.size)
+                {
+                    return DX_INVALID_FILE_ERROR;
+                }
+                // copy and convert to host order in one pass
+                if (header->endian == DX_MSB)
+                {
+                    BigToHost32(header->data,file->map.data + cur->pos,n/4);
+                }
+                else if (header->endian == DX_LSB)
+                {
+                    LittleToHost32(header->data,file->map.data + cur->pos,n/4);
+                }
+                else
+                {
+                    memcpy(header->data,file->map.data + cur->pos,n);
+                }
+                cur->pos += n;
+                break;
+            }
+            switch(header->type)
+            {
+                case DX_FLOAT: // load float data
+                {
+                    float *dataf;
+                    dataf = (float *)malloc(size*(header->items)*sizeof(float));
+                    if (dataf == NULL)
+                    {
+                        return DX_MEMORY_ERROR;
+                    }
+                    header->data = (void*)dataf;
+                    break;
+                }
+                case DX_INT: // load int data
+                {
+                    int *datai;
+                    datai = (int *)malloc(size*(header->items)*sizeof(int));
+                    if (datai == NULL)
+                    {
+                        return DX_MEMORY_ERROR;
+                    }
+                    header->data = (void*)datai;
+                    break;
+                }
+            }
+            // the header scan found where the data ends
+            if (ParseTextValues(file->map.data,cur->pos,obj->pos + obj->length,header->type,header->data,size*(header->items),file->numThreads) != size*(header->items))
+            {
+                return DX_INVALID_FILE_ERROR;
+            }
+            cur->pos = obj->pos + obj->length;
+            break;
+        case DX_OFFSET:
+            return DX_NOT_SUPPORTED_ERROR;
+        case DX_FILE:
+        {
+            if (header->dataType == DX_BINARY || header->dataType == DX_IEEE)
+            {
+                if (file->deferExternal)
+                {
+                    // left on disk, the caller reads it when it is needed
+                    header->data = NULL;
+                    break;
+                }
+                return LoadExternalArrayData(header,&(header->data));
+            }
+            else
+            {
+                mappedFile ext;
+                size_t pos;
+                size_t n;
+                if (MapFile(&ext,header->file) != 0)
+                {
+                    return DX_INVALID_FILE_ERROR;
+                }
+                pos = header->offset;
+                n = 0;
+                
+                header->data = malloc(size*(header->items)*GetTypeSize(header->type));
+                if (header->data != NULL)
+                {
+                    n = ParseTextValues(ext.data,pos,ext.size,header->type,header->data,size*(header->items),file->numThreads);
+                }
+                UnmapFile(&ext);
+                if (header->data == NULL)
+                {
+                    return DX_MEMORY_ERROR;
+                }
+                if (n != size*(header->items))
+                {
+                    return DX_INVALID_FILE_ERROR;
+                }
+            }
+        }
+            break;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief computes items of an array, whatever its class
+ * @details Implicit arrays are expanded without holding more than the 
+ * requested items, so a writer can expand them one window at a time. The
+ * values are in host order. Arrays with data must be loaded, an external 
+ * array left on disk can not be expanded.
+ * @param obj the array object, loaded
+ * @param first the first item
+ * @param n the number of items
+ * @param values output, n times GetItemSize() values
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ * @note Different threads may expand the same array at the same time.
+ */
+int DX_ExpandArray(object *obj, size_t first, size_t n, void *values)
+{
+    size_t i;
+    size_t c;
+    size_t m;
+    array *header;
+
+    if (!IsArrayObject(obj) || obj->isLoaded == 0)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+    header = (array *)(obj->obj);
+    if (first + n > (size_t)(header->items))
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+    m = GetItemSize(header);
+
+    switch (obj->class)
+    {
+        case DX_ARRAY:
+            if (header->data == NULL)
+            {
+                return DX_INVALID_USAGE_ERROR;
+            }
+            memcpy(values,(char *)(header->data) + first*m*GetTypeSize(header->type),n*m*GetTypeSize(header->type));
+            break;
+        case DX_CONSTANTARRAY:
+            for (i=0;i<n;i++)
+            {
+                memcpy((char *)values + i*m*GetTypeSize(header->type),header->origin,m*GetTypeSize(header->type));
+            }
+            break;
+        case DX_REGULARARRAY:
+            if (header->type == DX_FLOAT)
+            {
+                float *v = (float *)values;
+                float *origin = (float *)(header->origin);
+                float *delta = (float *)(header->delta);
+                for (i=0;i<n;i++)
+                {
+                    for (c=0;c<m;c++)
+                    {
+                        v[i*m+c] = origin[c] + (float)(first + i)*delta[c];
+                    }
+                }
+            }
+            else
+            {
+                int *v = (int *)values;
+                int *origin = (int *)(header->origin);
+                int *delta = (int *)(header->delta);
+                for (i=0;i<n;i++)
+                {
+                    for (c=0;c<m;c++)
+                    {
+                        v[i*m+c] = origin[c] + (int)(first + i)*delta[c];
+                    }
+                }
+            }
+            break;
+        case DX_PATHARRAY:
+            for (i=0;i<n;i++)
+            {
+                ((int *)values)[2*i] = (int)(first + i);
+                ((int *)values)[2*i+1] = (int)(first + i + 1);
+            }
+            break;
+        case DX_PRODUCTARRAY:
+            return ExpandProductArray(header,first,n,values);
+        case DX_MESHARRAY:
+            return ExpandMeshArray(header,first,n,values);
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief expands every term of a product or mesh array
+ * @details Terms are the axes of a grid, so they are small compared to the 
+ * array itself.
+ * @param header the product or mesh array
+ * @param values output, the values of each term, freed with FreeTerms()
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int ExpandTerms(array *header, void ***values)
+{
+    int j;
+    int rc;
+
+    *values = (void **)calloc(header->numTerms,sizeof(void *));
+    if (*values == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    for (j=0;j<(header->numTerms);j++)
+    {
+        array *term = (array *)(header->terms[j]->obj);
+        (*values)[j] = malloc(GetArraySize(term)*GetTypeSize(term->type));
+        if ((*values)[j] == NULL)
+        {
+            FreeTerms(header,*values);
+            return DX_MEMORY_ERROR;
+        }
+        rc = DX_ExpandArray(header->terms[j],0,term->items,(*values)[j]);
+        if (rc != DX_SUCCESS)
+        {
+            FreeTerms(header,*values);
+            return rc;
+        }
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief frees the term values from ExpandTerms()
+ * @param header the product or mesh array
+ * @param values the values of each term
+ */
+void FreeTerms(array *header, void **values)
+{
+    int j;
+    for (j=0;j<(header->numTerms);j++)
+    {
+        free(values[j]);
+    }
+    free(values);
+}
+
+/**
+ * @brief computes items of a product array
+ * @details Item k is the sum of one item of each term, with the index into
+ * the last term varying fastest.
+ * @param header the product array
+ * @param first the first item
+ * @param n the number of items
+ * @param values output values
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int ExpandProductArray(array *header, size_t first, size_t n, void *values)
+{
+    size_t i;
+    size_t c;
+    size_t m;
+    int j;
+    int rc;
+    void **terms;
+
+    rc = ExpandTerms(header,&terms);
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    m = GetItemSize(header);
+    memset(values,0,n*m*GetTypeSize(header->type));
+    for (i=0;i<n;i++)
+    {
+        size_t k = first + i;
+        for (j=(header->numTerms)-1;j>=0;j--)
+        {
+            size_t items = ((array *)(header->terms[j]->obj))->items;
+            size_t index = k % items;
+            k /= items;
+            for (c=0;c<m;c++)
+            {
+                if (header->type == DX_FLOAT)
+                {
+                    ((float *)values)[i*m+c] += ((float *)(terms[j]))[index*m+c];
+                }
+                else
+                {
+                    ((int *)values)[i*m+c] += ((int *)(terms[j]))[index*m+c];
+                }
+            }
+        }
+    }
+    FreeTerms(header,terms);
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief computes items of a mesh array
+ * @details Each element is the product of one element of each path, its
+ * vertices are ordered with the last path varying fastest, e.g., a quad of 
+ * two paths is (i,j) (i,j+1) (i+1,j) (i+1,j+1).
+ * @param header the mesh array
+ * @param first the first item
+ * @param n the number of items
+ * @param values output values
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int ExpandMeshArray(array *header, size_t first, size_t n, void *values)
+{
+    size_t i;
+    int c;
+    int j;
+    int rc;
+    void **terms;
+    size_t index[DX_MAX_MESH_DIMENSIONS];
+    size_t stride[DX_MAX_MESH_DIMENSIONS];
+    int *v;
+
+    rc = ExpandTerms(header,&terms);
+    if (rc != DX_SUCCESS)
+    {
+        return rc;
+    }
+    // positions of the last path are adjacent
+    stride[(header->numTerms)-1] = 1;
+    for (j=(header->numTerms)-2;j>=0;j--)
+    {
+        stride[j] = stride[j+1]*(((array *)(header->terms[j+1]->obj))->items + 1);
+    }
+
+    v = (int *)values;
+    for (i=0;i<n;i++)
+    {
+        size_t k = first + i;
+        for (j=(header->numTerms)-1;j>=0;j--)
+        {
+            size_t items = ((array *)(header->terms[j]->obj))->items;
+            index[j] = k % items;
+            k /= items;
+        }
+        for (c=0;c<header->shape[0];c++)
+        {
+            size_t vertex = 0;
+            int r = c;
+            for (j=(header->numTerms)-1;j>=0;j--)
+            {
+                int s = ((array *)(header->terms[j]->obj))->shape[0];
+                vertex += ((int *)(terms[j]))[index[j]*s + r % s]*stride[j];
+                r /= s;
+            }
+            v[i*header->shape[0] + c] = (int)vertex;
+        }
+    }
+    FreeTerms(header,terms);
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief reads a binary array from its external data file
+ * @details The values are converted to host byte order. The array header is
+ * not modified, so this is safe to call for an array shared by several 
+ * threads, e.g., one left on disk by dxFile.deferExternal.
+ * @param header the array, with data mode file
+ * @param data output pointer to the values, to be released with free()
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int LoadExternalArrayData(array *header, void **data)
+{
+    FILE *fp; // external data file
+    size_t n;
+
+    if (header->dataMode != DX_FILE)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+    n = GetArraySize(header);
+    *data = malloc(n*GetTypeSize(header->type));
+    if (*data == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    fp = fopen(header->file,"rb");
+    if (fp == NULL)
+    {
+        free(*data);
+        *data = NULL;
+        return DX_FILE_NOT_FOUND_ERROR;
+    }
+    if (fseek(fp,header->offset,SEEK_SET) != 0 
+        || fread(*data,GetTypeSize(header->type),n,fp) != n)
+    {
+        fclose(fp);
+        free(*data);
+        *data = NULL;
+        return DX_INVALID_FILE_ERROR;
+    }
+    fclose(fp);
+    // check if the endianess is the different
+    if (header->endian == DX_MSB)
+    {
+        BigToHost32(*data,*data,n);
+    }
+    else if (header->endian == DX_LSB)
+    {
+        LittleToHost32(*data,*data,n);
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief task context for parsing a text block in chunks
+ */
+typedef struct textChunks_struct textChunks;
+struct textChunks_struct {
+    const char *buf;
+    unsigned char type;
+    void *values;
+    size_t n;
+    size_t *bounds; // numChunks+1 chunk boundaries
+    size_t *counts; // tokens per chunk, then the index of the chunk's first value
+};
+
+void CountChunkTask(void *ctx, size_t c)
+{
+    textChunks *tc = (textChunks *)ctx;
+    tc->counts[c] = CountTokens(tc->buf,tc->bounds[c+1],tc->bounds[c]);
+}
+
+void ParseChunkTask(void *ctx, size_t c)
+{
+    textChunks *tc = (textChunks *)ctx;
+    size_t first;
+    size_t count;
+    size_t pos;
+    first = tc->counts[c];
+    if (first >= tc->n)
+    {
+        return;
+    }
+    count = tc->counts[c+1] - first;
+    if (first + count > tc->n)
+    {
+        count = tc->n - first;
+    }
+    pos = tc->bounds[c];
+    if (tc->type == DX_FLOAT)
+    {
+        ParseFloats(tc->buf,tc->bounds[c+1],&pos,(float *)(tc->values) + first,count);
+    }
+    else
+    {
+        ParseInts(tc->buf,tc->bounds[c+1],&pos,(int *)(tc->values) + first,count);
+    }
+}
+
+/**
+ * @brief parses a block of whitespace separated text values
+ * @details Large blocks are split into chunks at token boundaries, the tokens 
+ * in each chunk are counted in parallel, a prefix sum gives the index of the 
+ * first value of every chunk and the chunks are then parsed in parallel
+ * straight into their place in values.
+ * @param buf the text buffer
+ * @param start the offset of the first value
+ * @param end the offset just past the block, any tokens after the first n are 
+ * ignored
+ * @param type DX_FLOAT or DX_INT
+ * @param values the output array
+ * @param n the number of values to read
+ * @param numThreads the maximum number of threads to use
+ * @returns the number of values read, less than n if the block is too short
+ */
+size_t ParseTextValues(const char *buf, size_t start, size_t end, unsigned char type, void *values, size_t n, int numThreads)
+{
+    textChunks tc;
+    size_t numChunks;
+    size_t c;
+    size_t total;
+
+    numChunks = (end - start)/DX_PARALLEL_CHUNK_SIZE;
+    if (numChunks > 4*numThreads)
+    {
+        numChunks = 4*numThreads;
+    }
+    if (numThreads <= 1 || numChunks <= 1)
+    {
+        size_t pos = start;
+        if (type == DX_FLOAT)
+        {
+            return ParseFloats(buf,end,&pos,(float *)values,n);
+        }
+        return ParseInts(buf,end,&pos,(int *)values,n);
+    }
+
+    tc.buf = buf;
+    tc.type = type;
+    tc.values = values;
+    tc.n = n;
+    tc.bounds = (size_t *)malloc((numChunks+1)*sizeof(size_t));
+    tc.counts = (size_t *)malloc((numChunks+1)*sizeof(size_t));
+    if (tc.bounds == NULL || tc.counts == NULL)
+    {
+        free(tc.bounds);
+        free(tc.counts);
+        return 0;
+    }
+
+    // split at whitespace, moving to the end of the line if the split
+    // would land inside a comment
+    tc.bounds[0] = start;
+    for (c=1;c<numChunks;c++)
+    {
+        size_t b;
+        size_t l;
+        b = start + c*((end - start)/numChunks);
+        if (b < tc.bounds[c-1])
+        {
+            b = tc.bounds[c-1];
+        }
+        while (b < end && buf[b] != ' ' && buf[b] != '\n' && buf[b] != '\t' && buf[b] != '\r')
+        {
+            b++;
+        }
+        for (l=b;l>start && buf[l-1] != '\n';l--)
+        {
+            if (buf[l-1] == '#')
+            {
+                while (b < end && buf[b] != '\n')
+                {
+                    b++;
+                }
+                break;
+            }
+        }
+        tc.bounds[c] = b;
+    }
+    tc.bounds[numChunks] = end;
+
+    ParallelFor(numThreads,numChunks,CountChunkTask,&tc);
+
+    // exclusive prefix sum
+    total = 0;
+    for (c=0;c<numChunks;c++)
+    {
+        size_t count = tc.counts[c];
+        tc.counts[c] = total;
+        total += count;
+    }
+    tc.counts[numChunks] = total;
+
+    ParallelFor(numThreads,numChunks,ParseChunkTask,&tc);
+
+    free(tc.bounds);
+    free(tc.counts);
+    return (total < n) ? total : n;
+}
+
+/**
+ * @brief loads girdpositions data
+ * @details allocates memory and loads gridpositions into memory
+ * @param obj the pointer which wraps the array object
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
+ * after the array header.
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int LoadGridPositionsData(object *obj, dxFile *file, dxCursor *cur)
+{
+    char *save;
+    int i,j;
+    gridpositions *data;
+    char buffer[DX_MAX_TOKEN_LENGTH];
+
+    if (obj->class != DX_GRIDPOSITIONS)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+
+    data = (gridpositions *)(obj->obj);
+    
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    if (!streq(buffer,"origin"))
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+
+    for (i=0;i<(data->numCounts);i++)
+    {
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+        data->origin[i] = atof(buffer);
+    }
+
+    for (i=0;i<(data->numCounts);i++)
+    {
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+        if (!streq(buffer,"delta"))
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+        
+        for (j=0;j<(data->numCounts);j++)
+        {
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+            data->deltas[i*(data->numCounts)+j] = atof(buffer);
+        }
+    }
+
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief loads array data
+ * @details allocates memory and loads data array into memory
+ * @param obj the pointer which wraps the array object
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
+ * after the array header.
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int LoadGridConnectionsData(object *obj, dxFile *file, dxCursor *cur)
+{
+    char *save;
+    char buffer[DX_MAX_TOKEN_LENGTH];
+    if (obj->class != DX_GRIDCONNECTIONS)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+
+    if (streq(buffer,"meshoffsets"))
+    {
+        return DX_NOT_SUPPORTED_ERROR;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief loads the item of a constant array
+ * @details Only the single item that follows the header is read, however
+ * many items the array has.
+ * @param obj the pointer which wraps the constant array object
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
+ * after the array header.
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int LoadConstantArrayData(object *obj, dxFile *file, dxCursor *cur)
+{
+    array *header;
+    size_t size;
+
+    if (obj->class != DX_CONSTANTARRAY)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+
+    header = (array *)(obj->obj);
+    if (header->dataMode != DX_FOLLOWS)
+    {
+        return DX_NOT_SUPPORTED_ERROR;
+    }
+    size = GetItemSize(header);
+    header->origin = malloc(size*GetTypeSize(header->type));
+    if (header->origin == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+
+    if (header->dataType == DX_BINARY || header->dataType == DX_IEEE)
+    {
+        if (cur->pos + size*GetTypeSize(header->type) > file->map.size)
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+        if (header->endian == DX_MSB)
+        {
+            BigToHost32(header->origin,file->map.data + cur->pos,size);
+        }
+        else
+        {
+            LittleToHost32(header->origin,file->map.data + cur->pos,size);
+        }
+        cur->pos += size*GetTypeSize(header->type);
+    }
+    else
+    {
+        if (ParseTextValues(file->map.data,cur->pos,obj->pos + obj->length,header->type,header->origin,size,1) != size)
+        {
+            return DX_INVALID_FILE_ERROR;
+        }
+        cur->pos = obj->pos + obj->length;
+    }
+    return DX_SUCCESS;
+}
+
+/**
+ * @brief loads the origin and delta of a regular array
+ * @details The origin and delta may follow the counts on the header line or
+ * be given on the lines after it. Without a shape, the number of origin 
+ * values sets the shape.
+ * @param obj the pointer which wraps the regular array object
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
+ * after the array header.
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int LoadRegularArrayData(object *obj, dxFile *file, dxCursor *cur)
+{
+    int i;
+    int numOrigin;
+    int numDelta;
+    array *header;
+    dxCursor line;
+    double origin[DX_MAX_ITEM_VALUES];
+    double delta[DX_MAX_ITEM_VALUES];
+
+    if (obj->class != DX_REGULARARRAY)
+    {
+        return DX_INVALID_USAGE_ERROR;
+    }
+
+    header = (array *)(obj->obj);
+    line.pos = obj->header;
+    ReadDXLine(file,&line);
+    numOrigin = ParseItemValues(line.line,"origin",origin,DX_MAX_ITEM_VALUES);
+    numDelta = ParseItemValues(line.line,"delta",delta,DX_MAX_ITEM_VALUES);
+    if (numOrigin < 0)
+    {
+        ReadDXLine(file,cur);
+        numOrigin = ParseItemValues(cur->line,"origin",origin,DX_MAX_ITEM_VALUES);
+    }
+    if (numDelta < 0)
+    {
+        ReadDXLine(file,cur);
+        numDelta = ParseItemValues(cur->line,"delta",delta,DX_MAX_ITEM_VALUES);
+    }
+    if (numOrigin <= 0 || numDelta != numOrigin)
+    {
+        return DX_INVALID_FILE_ERROR;
+    }
+    if (header->rank == 0 && numOrigin > 1)
+    {
+        header->rank = 1;
+        header->shape[0] = numOrigin;
+    }
+    if (GetItemSize(header) != (size_t)numOrigin)
+    {
+        return DX_INVALID_FILE_ERROR;
     }
 
-    header = (array *)(obj->obj);
-    size = 1;
-    for (i=0;i<(header->rank);i++)
+    header->origin = malloc(numOrigin*GetTypeSize(header->type));
+    header->delta = malloc(numDelta*GetTypeSize(header->type));
+    if (header->origin == NULL || header->delta == NULL)
     {
-        size *= (header->shape[i]);
+        return DX_MEMORY_ERROR;
     }
-    
-    switch(header->dataMode)
+    for (i=0;i<numOrigin;i++)
     {
-        default:
-        case DX_FOLLOWS:
-            switch(header->type)
-            {
-                case DX_FLOAT: // load float data
-                {
-                    float *dataf;
-                    dataf = (float *)malloc(size*(header->items)*sizeof(float));
-                    for (i=0;i<size*(header->items);i++)
-                    {
-                        fscanf(file->fp,"%f",dataf+i);
-                    }
-                    header->data = (void*)dataf;
-                    break;
-                }
-                case DX_INT: // load int data
-                {
-                    int *datai;
-                    datai = (int *)malloc(size*(header->items)*sizeof(int));
-                    for (i=0;i<size*(header->items);i++)
-                    {
-                        fscanf(file->fp,"%d",datai+i);
-                    }
-                    header->data = (void*)datai;
-                    break;
-                }
-
-                    break;
-            }
-            break;
-        case DX_OFFSET:
-            return DX_NOT_SUPPORTED_ERROR;
-        case DX_FILE:
+        if (header->type == DX_FLOAT)
         {
-            FILE *fp; // external data file
-            if (header->dataType == DX_BINARY || header->dataType == DX_IEEE)
-            {
-                int nbytes;
-                fp = fopen(header->file,"rb");
-                if (fp == NULL)
-                {
-                    return DX_INVALID_FILE_ERROR;
-                }
-                fseek(fp,header->offset,SEEK_SET);
-                switch(header->type)
-                {
-                    case DX_FLOAT:
-                        nbytes = size*DX_FLOAT_SIZE;
-                        break;
-                    case DX_INT:
-                        nbytes = size*DX_INT_SIZE;
-                        break;
-                }
-                header->data = malloc(nbytes*(header->items));
-                fread(header->data,nbytes,header->items,fp);
-                // check if the endianess is the different
-                if (header->endian == DX_MSB)
-                {
-                    uint32_t *data32 = (uint32_t *)header->data;
-                    for (i=0;i<size*(header->items);i++)
-                    {
-                        data32[i] = be32toh(data32[i]);
-                    }
-                }
-                else if (header->endian == DX_LSB)
-                {
-                    uint32_t *data32 = (uint32_t *)header->data;
-                    for (i=0;i<size*(header->items);i++)
-                    {
-                        data32[i] = le32toh(data32[i]);
-                    }
-                }
-                fclose(fp);
-            }
-            else
-            {
-                fp = fopen(header->file,"r");
-                if (fp == NULL)
-                {
-                    return DX_INVALID_FILE_ERROR;
-                }
-                fseek(fp,header->offset,SEEK_SET);
-                
-                switch(header->type)
-                {
-                    case DX_FLOAT: // load float data
-                    {
-                        float *dataf;
-                        dataf = (float *)malloc(size*(header->items)*sizeof(float));
-                        for (i=0;i<size*(header->items);i++)
-                        {
-                            fscanf(fp,"%f",dataf+i);
-                        }
-                        header->data = (void*)dataf;
-                        break;
-                    }
-                    case DX_INT: // load int data
-                    {
-                        int *datai;
-                        datai = (int *)malloc(size*(header->items)*sizeof(int));
-                        for (i=0;i<size*(header->items);i++)
-                        {
-                            fscanf(fp,"%d",datai+i);
-                        }
-                        header->data = (void*)datai;
-                        break;
-                    }
-                }
-                fclose(fp);
-            }
+            ((float *)(header->origin))[i] = (float)origin[i];
+            ((float *)(header->delta))[i] = (float)delta[i];
+        }
+        else
+        {
+            ((int *)(header->origin))[i] = (int)origin[i];
+            ((int *)(header->delta))[i] = (int)delta[i];
         }
-            break;
     }
     return DX_SUCCESS;
 }
 
 /**
- * @brief loads girdpositions data
- * @details allocates memory and loads gridpositions into memory
- * @param obj the pointer which wraps the array object
- * @param file the dxFile structure, assumes the stream cursor is located just
+ * @brief loads the terms of a product or mesh array
+ * @details The terms are loaded as well, as the items and shape of the 
+ * array follow from theirs. The items of a product array are the sums of 
+ * one item of each term, the terms of a mesh array must be path arrays.
+ * @param obj the pointer which wraps the product or mesh array object
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
  * after the array header.
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
-int LoadGridPositionsData(object *obj, dxFile *file)
+int LoadTermsData(object *obj, dxFile *file, dxCursor *cur)
 {
-    int i,j;
-    gridpositions *data;
+    char *save;
+    size_t pos;
+    int i;
+    int rc;
+    array *header;
     char buffer[DX_MAX_TOKEN_LENGTH];
 
-    if (obj->class != DX_GRIDPOSITIONS)
+    if (obj->class != DX_PRODUCTARRAY && obj->class != DX_MESHARRAY)
     {
         return DX_INVALID_USAGE_ERROR;
     }
 
-    data = (gridpositions *)(obj->obj);
-    
-    ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
-    if (!streq(buffer,"origin"))
+    header = (array *)(obj->obj);
+    header->numTerms = 0;
+
+    // count number of terms and return start
+    pos = cur->pos;
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    while (streq(buffer,"term"))
     {
-        return DX_INVALID_FILE_ERROR;
+        header->numTerms++;
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
+    cur->pos = pos;
 
-    for (i=0;i<(data->numCounts);i++)
+    if (header->numTerms == 0 || header->numTerms > DX_MAX_MESH_DIMENSIONS)
     {
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
-        data->origin[i] = atof(buffer);
+        return DX_NOT_SUPPORTED_ERROR;
+    }
+    header->terms = (object **)malloc((header->numTerms)*sizeof(object *));
+    if (header->terms == NULL)
+    {
+        return DX_MEMORY_ERROR;
     }
 
-    for (i=0;i<(data->numCounts);i++)
+    header->items = 1;
+    for (i=0;i<(header->numTerms);i++)
     {
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
-        if (!streq(buffer,"delta"))
+        array *term;
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+        if (streq(buffer,"value"))
+        {
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
+        }
+        header->terms[i] = GetObject(file,buffer);
+        if (header->terms[i] == NULL || !IsArrayObject(header->terms[i]))
         {
             return DX_INVALID_FILE_ERROR;
         }
-        
-        for (j=0;j<(data->numCounts);j++)
+        rc = DX_LoadObject(file,header->terms[i],0);
+        if (rc != DX_SUCCESS)
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
-            data->deltas[i*(data->numCounts)+j] = atof(buffer);
+            return rc;
         }
-    }
+        term = (array *)(header->terms[i]->obj);
 
+        if (obj->class == DX_MESHARRAY)
+        {
+            if (header->terms[i]->class != DX_PATHARRAY)
+            {
+                return DX_NOT_SUPPORTED_ERROR;
+            }
+            header->type = DX_INT;
+            header->rank = 1;
+            header->shape[0] = (i == 0) ? term->shape[0] : header->shape[0]*term->shape[0];
+        }
+        else if (i == 0)
+        {
+            header->type = term->type;
+            header->rank = term->rank;
+            memcpy(header->shape,term->shape,sizeof(header->shape));
+        }
+        else if (term->type != header->type || GetItemSize(term) != GetItemSize(header))
+        {
+            return DX_NOT_SUPPORTED_ERROR;
+        }
+        header->items *= term->items;
+    }
     return DX_SUCCESS;
 }
 
 /**
- * @brief loads array data
- * @details allocates memory and loads data array into memory
- * @param obj the pointer which wraps the array object
- * @param file the dxFile structure, assumes the stream cursor is located just
- * after the array header.
- * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ * @brief parses the numbers that follow a keyword on a line
+ * @details e.g., the origin of a regular array from "origin 0 0 1".
+ * @param line the line
+ * @param key the keyword
+ * @param values output numbers
+ * @param max the maximum number of values
+ * @returns the number of values, or -1 if the line has no such keyword
  */
-int LoadGridConnectionsData(object *obj, dxFile *file)
+int ParseItemValues(char *line, const char *key, double *values, int max)
 {
+    char *save;
+    char *end;
     char buffer[DX_MAX_TOKEN_LENGTH];
-    if (obj->class != DX_GRIDCONNECTIONS)
-    {
-        return DX_INVALID_USAGE_ERROR;
-    }
-    ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+    int n;
 
-    if (streq(buffer,"meshoffsets"))
+    n = -1;
+    StringTokenR(line,buffer,DX_MAX_TOKEN_LENGTH,&save);
+    while (buffer[0] != '\0')
     {
-        return DX_NOT_SUPPORTED_ERROR;
+        if (n < 0)
+        {
+            n = streq(buffer,key) ? 0 : -1;
+        }
+        else
+        {
+            double v;
+            v = strtod(buffer,&end);
+            if (end == buffer || *end != '\0' || n == max)
+            {
+                break;
+            }
+            values[n++] = v;
+        }
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
-    return DX_SUCCESS;
+    return n;
 }
 
 /**
  * @brief loads series data
  * @details allocates memory and loads series into memory
  * @param obj the pointer which wraps the array object
- * @param file the dxFile structure, assumes the stream cursor is located just
+ * @param file the dxFile structure
+ * @param cur the read cursor, assumes it is located just
  * after the array header.
  * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
  */
-int LoadSeriesData(object *obj, dxFile *file)
+int LoadSeriesData(object *obj, dxFile *file, dxCursor *cur)
 {
-    fpos_t pos;
+    char *save;
+    size_t pos;
     series * data;
     int i,j,ind;
     char buffer[DX_MAX_TOKEN_LENGTH];
@@ -1098,17 +2493,17 @@ int LoadSeriesData(object *obj, dxFile *file)
     data->numMembers = 0;
 
     // count the number of members
-    fgetpos(file->fp,&pos);
-    ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+    pos = cur->pos;
+    ReadDXLine(file,cur);
+    StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     
     while(streq(buffer,"member"))
     {
         data->numMembers++;
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
-    fsetpos(file->fp,&pos);
+    cur->pos = pos;
 
     // allocate memory for the members
     data->positions = (float *)malloc((data->numMembers)*sizeof(float));
@@ -1132,26 +2527,26 @@ int LoadSeriesData(object *obj, dxFile *file)
     for (i=0;i<(data->numMembers);i++)
     {
         // read the line
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+        ReadDXLine(file,cur);
         // read member
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
         // get member index
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         ind = atoi(buffer);
         if (ind < 0 || ind >= data->numMembers)
         {
             return DX_INVALID_FILE_ERROR;
         }
         // read position
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         // read position number
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         data->positions[ind] = atof(buffer);
         // read reference
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         if (streq(buffer,"value"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         }
         strncpy(ref,buffer,DX_MAX_TOKEN_LENGTH);
 
@@ -1170,14 +2565,16 @@ int LoadSeriesData(object *obj, dxFile *file)
  * @brief loads attribute data for the current object
  * @param obj the object currently being read
  * @param file the OpenDX file
+ * @param cur the read cursor
  * @returns DX_SUCCESS or an appropriate error code
- * @note this assumes that the file cursor is located at the start of the 
+ * @note this assumes that the cursor is located at the start of the 
  * first attribute line
  */
-int LoadAttributes(object *obj,dxFile *file)
+int LoadAttributes(object *obj, dxFile *file, dxCursor *cur)
 {
+    char *save;
     char buffer[DX_MAX_TOKEN_LENGTH];
-    fpos_t pos;
+    size_t pos;
     int i;
     int rc;
     obj->numAttributes = 0;
@@ -1189,19 +2586,19 @@ int LoadAttributes(object *obj,dxFile *file)
         printf("blank\n");
 #endif
         // we will need to come back here  
-        fgetpos(file->fp,&pos);
-        rc = ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-    } while (rc == 0 && StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH) == NULL);
+        pos = cur->pos;
+        rc = ReadDXLine(file,cur);
+    } while (rc == 0 && StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save) == NULL);
     
     // count the attibutes
     while (streq(buffer,"attribute"))
     {
         obj->numAttributes++;
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        ReadDXLine(file,cur);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
     }
     // jump back to start of attributes
-    fsetpos(file->fp,&pos);
+    cur->pos = pos;
     
     // allocate memory
     obj->attributes = (attribute *)malloc((obj->numAttributes)*sizeof(attribute));
@@ -1214,17 +2611,17 @@ int LoadAttributes(object *obj,dxFile *file)
     /** @todo currently external file references in attributes is not supported*/
     for (i=0;i<(obj->numAttributes);i++)
     {
-        ReadLine(file->fp,read_buf,DX_READ_BUFFER_SIZE);
+        ReadDXLine(file,cur);
         // read attribute key word
-        StringToken(read_buf,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(cur->line,buffer,DX_MAX_TOKEN_LENGTH,&save);
         // read the attribute name and store
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         strncpy(obj->attributes[i].attribute_name,buffer,DX_MAX_TOKEN_LENGTH);
         // read the type 
-        StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+        StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         if (streq(buffer,"value"))
         {
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         }
 
         if (streq(buffer,"file"))
@@ -1235,7 +2632,7 @@ int LoadAttributes(object *obj,dxFile *file)
         else if (streq(buffer,"string") || streq(buffer,"number"))
         {
             // read the value
-            StringToken(NULL,buffer,DX_MAX_TOKEN_LENGTH);
+            StringTokenR(NULL,buffer,DX_MAX_TOKEN_LENGTH,&save);
         }
 
         strncpy(obj->attributes[i].string,buffer,DX_MAX_TOKEN_LENGTH);
@@ -1260,6 +2657,11 @@ void PrintObjectHeader(object *obj)
     switch(obj->class)
     {
         case DX_ARRAY:
+        case DX_CONSTANTARRAY:
+        case DX_REGULARARRAY:
+        case DX_PATHARRAY:
+        case DX_PRODUCTARRAY:
+        case DX_MESHARRAY:
         {
             array * header = (array *)obj->obj;
             printf("\ttype: %hhu\n",header->type);
@@ -1274,6 +2676,7 @@ void PrintObjectHeader(object *obj)
             printf("\titems: %d\n",header->items);
             printf("\tspec: %hhu %hhu\n",header->endian,header->dataType);
             printf("\tmode: %hhu (%s)[%d]\n",header->dataMode,header->file,header->offset);
+            printf("\t#terms: %d\n",header->numTerms);
         }
             break;
         case DX_FIELD:
@@ -1345,8 +2748,179 @@ attribute * GetAttribute(object *obj,char * key)
     return NULL;
 }
 
+/**
+ * @brief reads the next line of the mapped file
+ * @param file the dxFile structure
+ * @param cur the cursor, the line is read from cur->pos into cur->line
+ * @returns 1 if the end of the file is reached
+ */
+int ReadDXLine(dxFile *file, dxCursor *cur)
+{
+    return MemReadLine(file->map.data,file->map.size,&(cur->pos),cur->line,DX_READ_BUFFER_SIZE);
+}
+
+/**
+ * @brief Gets the number of values stored in an array
+ * @param data the array header
+ * @returns the number of items multiplied by the size of each item
+ */
+size_t GetArraySize(array *data)
+{
+    int i;
+    size_t size;
+    size = 1;
+    for (i=0;i<(data->rank);i++)
+    {
+        size *= (data->shape[i]);
+    }
+    return size*(data->items);
+}
+
+/**
+ * @brief Gets the number of values in each item of an array
+ * @param data the array header
+ * @returns the product of the shape
+ */
+size_t GetItemSize(array *data)
+{
+    int i;
+    size_t size;
+    size = 1;
+    for (i=0;i<(data->rank);i++)
+    {
+        size *= (data->shape[i]);
+    }
+    return size;
+}
+
+/**
+ * @brief tests if an object is an array of any class
+ * @param obj the object
+ * @returns non-zero for arrays and implicit arrays
+ */
+int IsArrayObject(object *obj)
+{
+    switch (obj->class)
+    {
+        case DX_ARRAY:
+        case DX_CONSTANTARRAY:
+        case DX_REGULARARRAY:
+        case DX_PATHARRAY:
+        case DX_PRODUCTARRAY:
+        case DX_MESHARRAY:
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets the size in bytes of a data type
+ * @param type the data type, DX_INT or DX_FLOAT
+ * @returns the number of bytes per value
+ */
+size_t GetTypeSize(unsigned char type)
+{
+    switch(type)
+    {
+        case DX_FLOAT:
+            return DX_FLOAT_SIZE;
+        case DX_INT:
+        default:
+            return DX_INT_SIZE;
+    }
+}
+
+/**
+ * @brief hashes an object name (FNV-1a)
+ */
+unsigned int HashName(const char *name)
+{
+    unsigned int h;
+    h = 2166136261u;
+    while (*name != '\0')
+    {
+        h ^= (unsigned char)(*name);
+        h *= 16777619u;
+        name++;
+    }
+    return h;
+}
+
+/**
+ * @brief hashes an object number
+ */
+unsigned int HashNumber(int number)
+{
+    return (unsigned int)number * 2654435761u;
+}
+
+/**
+ * @brief builds the hash tables used to look objects up by name and number
+ * @details Both tables use open addressing with linear probing and store the
+ * index of the object in file->objs, or -1 for an empty slot. If a name or 
+ * number occurs more than once the first object wins, matching a linear search.
+ * Objects with a name that is not a number are not in the number table.
+ * @param file the dxFile with all object headers read
+ * @returns DX_SUCCESS on compeletion, otherwise an appropriate error message
+ */
+int BuildObjectTable(dxFile *file)
+{
+    int i;
+    unsigned int mask;
+
+    file->tableSize = DX_INITIAL_OBJECTS;
+    while (file->tableSize < 2*(file->numObjects))
+    {
+        file->tableSize *= 2;
+    }
+    mask = file->tableSize - 1;
+
+    file->nameTable = (int *)malloc((file->tableSize)*sizeof(int));
+    file->numberTable = (int *)malloc((file->tableSize)*sizeof(int));
+    if (file->nameTable == NULL || file->numberTable == NULL)
+    {
+        return DX_MEMORY_ERROR;
+    }
+    for (i=0;i<(file->tableSize);i++)
+    {
+        file->nameTable[i] = -1;
+        file->numberTable[i] = -1;
+    }
+
+    for (i=0;i<(file->numObjects);i++)
+    {
+        unsigned int h;
+        h = HashName(file->objs[i].name) & mask;
+        while (file->nameTable[h] >= 0 && !streq(file->objs[file->nameTable[h]].name,file->objs[i].name))
+        {
+            h = (h + 1) & mask;
+        }
+        if (file->nameTable[h] < 0)
+        {
+            file->nameTable[h] = i;
+        }
+
+        if (file->objs[i].number < 0)
+        {
+            continue;
+        }
+        h = HashNumber(file->objs[i].number) & mask;
+        while (file->numberTable[h] >= 0 && file->objs[file->numberTable[h]].number != file->objs[i].number)
+        {
+            h = (h + 1) & mask;
+        }
+        if (file->numberTable[h] < 0)
+        {
+            file->numberTable[h] = i;
+        }
+    }
+    return DX_SUCCESS;
+}
+
 /**
  * @brief Gets an object by name if it exists
+ * @details references such as 01 that are numeric but do not match a name 
+ * exactly are looked up by number.
  * @param file the openDX file object
  * @param name the key name to search for
  * @returns a pointer to the object, NULL if the object does not exist
@@ -1354,11 +2928,75 @@ attribute * GetAttribute(object *obj,char * key)
 object * GetObject(dxFile *file, char *name)
 {
     int i;
-    for (i=0;i<(file->numObjects);i++)
+    unsigned int h;
+    unsigned int mask;
+    char *end;
+    long number;
+
+    if (file->nameTable == NULL)
+    {
+        for (i=0;i<(file->numObjects);i++)
+        {
+            if (streq(file->objs[i].name,name))
+            {
+                return file->objs + i;
+            }
+        }
+        return NULL;
+    }
+
+    mask = file->tableSize - 1;
+    for (h = HashName(name) & mask;file->nameTable[h] >= 0;h = (h + 1) & mask)
+    {
+        if (streq(file->objs[file->nameTable[h]].name,name))
+        {
+            return file->objs + file->nameTable[h];
+        }
+    }
+
+    number = strtol(name,&end,10);
+    if (end != name && *end == '\0')
+    {
+        return GetObjectByNumber(file,(int)number);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gets an object by number if it exists
+ * @param file the openDX file object
+ * @param number the object number to search for
+ * @returns a pointer to the object, NULL if the object does not exist
+ */
+object * GetObjectByNumber(dxFile *file, int number)
+{
+    int i;
+    unsigned int h;
+    unsigned int mask;
+
+    // named objects have no number
+    if (number < 0)
+    {
+        return NULL;
+    }
+    if (file->numberTable == NULL)
+    {
+        for (i=0;i<(file->numObjects);i++)
+        {
+            if (file->objs[i].number == number)
+            {
+                return file->objs + i;
+            }
+        }
+        return NULL;
+    }
+
+    mask = file->tableSize - 1;
+    for (h = HashNumber(number) & mask;file->numberTable[h] >= 0;h = (h + 1) & mask)
     {
-        if (streq(file->objs[i].name,name))
+        if (file->objs[file->numberTable[h]].number == number)
         {
-            return file->objs + i;
+            return file->objs + file->numberTable[h];
         }
     }
     return NULL;
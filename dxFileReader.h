@@ -37,14 +37,24 @@
 
 #include <endian.h>
 #include <stdint.h> 
+#include <unistd.h>
+#include <sys/stat.h>
 #include "ioutils.h"
+#include "parallel.h"
+#include "byteSwap.h"
 
 // buffer sizes
 #define DX_MAX_FILENAME_LENGTH      256
 #define DX_MAX_TOKEN_LENGTH         32
 #define DX_MAX_MESH_DIMENSIONS      6
+#define DX_MAX_ITEM_VALUES          64 // values per item of a regular array
 #define DX_COMMENT_LENGTH           256
 #define DX_READ_BUFFER_SIZE         2048
+#define DX_INITIAL_OBJECTS          64
+#define DX_INDEX_EXTENSION          ".dxidx"
+#define DX_INDEX_MAGIC              "DXIDX"
+#define DX_INDEX_VERSION            1
+#define DX_PARALLEL_CHUNK_SIZE      (1<<20) // min bytes of text per thread
 
 // return codes
 #define DX_SUCCESS                  1
@@ -95,6 +105,8 @@
 #define DX_FOLLOWS                  2
 
 #define streq(a,b) (strcmp((a),(b)) == 0)
+// compare a token span (not null terminated) with a string
+#define spaneq(a,n,b) ((n) == strlen(b) && strncmp((a),(b),(n)) == 0)
 
 // type defs
 typedef struct object_struct object;
@@ -106,18 +118,22 @@ typedef struct gridpositions_struct gridpositions;
 typedef struct gridconnections_struct gridconnections;
 typedef struct series_struct series;
 typedef struct dxFile_struct dxFile;
+typedef struct dxCursor_struct dxCursor;
 
 /*DX data object*/
 struct object_struct{
     unsigned char class;
     char alias[DX_MAX_TOKEN_LENGTH];
     char name[DX_MAX_TOKEN_LENGTH];
-    int number;
+    int number; // -1 if the name is not a number, e.g., "foo"
     unsigned char isLoaded;
+    int refCount; // users of the loaded data, see DX_AcquireObject()
     void *obj; // pointer to actual class instance
     int numAttributes;
     attribute *attributes;
-    fpos_t pos; // cursor pos after header
+    size_t header; // byte offset of header text
+    size_t pos; // byte offset after header
+    size_t length; // bytes of inline data following the header
 };
 
 struct array_struct{
@@ -132,6 +148,12 @@ struct array_struct{
     char file[DX_MAX_TOKEN_LENGTH];
     int offset;
     void *data;
+    // implicit arrays (constant, regular, path, product and mesh arrays) 
+    // keep data NULL and are expanded on demand, see DX_ExpandArray()
+    void *origin; // regular: the first item, constant: every item
+    void *delta; // regular: the difference of consecutive items
+    int numTerms; // product and mesh: the factor arrays, last varies fastest
+    object **terms;
 };
 
 struct attribute_struct{
@@ -140,9 +162,12 @@ struct attribute_struct{
     int number;
 };
 
+/* components are named in the field, not in the component objects, which
+ * may be shared by fields that are loaded and converted concurrently*/
 struct field_struct{
     int numComponents;
     object **components;
+    char (*aliases)[DX_MAX_TOKEN_LENGTH]; // the name of each component
 };
 
 struct group_struct{
@@ -170,16 +195,38 @@ struct series_struct{
 
 struct dxFile_struct{
     char *filename;
-    FILE *fp;
+    mappedFile map; // file contents
     int numObjects;
     object *objs;
+    int numThreads; // threads used to parse large text arrays
+    int deferExternal; // if non-zero, external binary arrays are not read
+    int tableSize; // hash table slots, a power of two
+    int *nameTable; // object indices hashed by name
+    int *numberTable; // object indices hashed by number
+};
+
+/* read state for one pass over a dxFile, kept by the caller so several
+ * objects can be loaded at the same time*/
+struct dxCursor_struct{
+    size_t pos; // current read offset in map
+    char line[DX_READ_BUFFER_SIZE]; // last line read
 };
 
 // function prototypes
 int DX_Open(dxFile *file,const char * filename);
+int DX_OpenIndexed(dxFile *file, const char * filename);
+int DX_ReadIndex(dxFile *file, const char *filename, const char *indexname);
+int DX_WriteIndex(dxFile *file, const char *indexname);
+void GetIndexFilename(const char *filename, char *indexname, int size);
 int DX_LoadAll(dxFile *file);
+int DX_LoadObject(dxFile *file, object *obj, int recursive);
+int DX_UnloadObject(dxFile *file, object *obj);
+int DX_AcquireObject(dxFile *file, object *obj);
+int DX_ReleaseObject(dxFile *file, object *obj);
+int GetObjectReferences(object *obj, object ***refs);
 int DX_Close(dxFile *file);
 int ParseObjectHeader(object *obj,  char* header);
+int SkipArrayData(object *obj, dxFile *file, dxCursor *cur);
 
 int ParseArrayObjectHeader(object *obj,char *header);
 int ParseFieldObjectHeader(object *obj,char *header);
@@ -189,16 +236,37 @@ int ParseGridPositionsObjectHeader(object *obj, char *header);
 int ParseGridConnectionsObjectHeader(object *obj,char *header);
 int ParseSeriesObjectHeader(object *obj, char* header);
 
-int LoadObjectData(object *obj,dxFile *file);
-int LoadArrayData(object *obj,dxFile *file);
-int LoadFieldData(object *obj,dxFile *file);
-int LoadGroupData(object *obj,dxFile *file);
-int LoadGridPositionsData(object *obj, dxFile *file);
-int LoadGridConnectionsData(object *obj, dxFile *file);
-int LoadSeriesData(object *obj, dxFile *file);
-int LoadAttributes(object *obj,dxFile *file);
+int LoadObjectData(object *obj, dxFile *file, dxCursor *cur);
+int LoadArrayData(object *obj, dxFile *file, dxCursor *cur);
+int LoadFieldData(object *obj, dxFile *file, dxCursor *cur);
+int LoadGroupData(object *obj, dxFile *file, dxCursor *cur);
+int LoadGridPositionsData(object *obj, dxFile *file, dxCursor *cur);
+int LoadGridConnectionsData(object *obj, dxFile *file, dxCursor *cur);
+int LoadSeriesData(object *obj, dxFile *file, dxCursor *cur);
+int LoadConstantArrayData(object *obj, dxFile *file, dxCursor *cur);
+int LoadRegularArrayData(object *obj, dxFile *file, dxCursor *cur);
+int LoadTermsData(object *obj, dxFile *file, dxCursor *cur);
+int ParseItemValues(char *line, const char *key, double *values, int max);
+int LoadAttributes(object *obj, dxFile *file, dxCursor *cur);
+int LoadExternalArrayData(array *header, void **data);
+int DX_ExpandArray(object *obj, size_t first, size_t n, void *values);
+int ExpandTerms(array *header, void ***values);
+void FreeTerms(array *header, void **values);
+int ExpandProductArray(array *header, size_t first, size_t n, void *values);
+int ExpandMeshArray(array *header, size_t first, size_t n, void *values);
+size_t ParseTextValues(const char *buf, size_t start, size_t end, unsigned char type, void *values, size_t n, int numThreads);
 
 void PrintObjectHeader(object *obj);
 attribute * GetAttribute(object *obj,char * key);
 object * GetObject(dxFile *file, char * name);
+object * GetObjectByNumber(dxFile *file, int number);
+int BuildObjectTable(dxFile *file);
+void FreeObjectHeader(object *obj);
+unsigned int HashName(const char *name);
+unsigned int HashNumber(int number);
+size_t GetArraySize(array *data);
+size_t GetItemSize(array *data);
+int IsArrayObject(object *obj);
+int ReadDXLine(dxFile *file, dxCursor *cur);
+size_t GetTypeSize(unsigned char type);
 #endif
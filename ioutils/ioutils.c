@@ -1,4 +1,10 @@
 
+#include <stdlib.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "ioutils.h"
 
 /**
@@ -10,35 +16,62 @@
  * @param token the ouput buffer for the next token.
  * @param size the size of the token buffer.
  * @returns the pointer to the unprocessed protion of the buffer, or
- * NULL if no buffer has been initialised or the end of buffer is reached.
+ * NULL if no buffer has been initialised or no token was found.
+ * @warning This function keeps its position in static storage and is not
+ * reentrant, use StringTokenR() when more than one string may be tokenised
+ * at a time.
+ */
+char * StringToken(char * buffer, char* token,int size)
+{
+    static char *save = NULL;
+    return StringTokenR(buffer,token,size,&save);
+}
+
+/**
+ * @brief Reentrant version of StringToken().
+ * @details The position in the string is kept in the caller supplied save
+ * pointer, in the same way as strtok_r().
+ * @param buffer The input string buffer, if buffer is NULL then the 
+ * process continues from *save.
+ * @param token the ouput buffer for the next token.
+ * @param size the size of the token buffer.
+ * @param save the tokeniser state, points at the unprocessed portion of the
+ * buffer.
+ * @returns the pointer to the unprocessed protion of the buffer, or
+ * NULL if no buffer has been initialised or no token was found.
  * @warning This code uses the null-termination character to determine the end
  * of the buffer. The behaviour is undefined if the buffer does not contain 
  * this character.
  */
-char * StringToken(char * buffer, char* token,int size)
+char * StringTokenR(char * buffer, char* token,int size, char **save)
 {
     char c;
     unsigned char state;
     int index;
-    static char *buf = NULL;
-    static int pos = 0;
+    char *buf;
     
     if (buffer != NULL)
     {
-        pos = 0;
-        buf = buffer;
+        *save = buffer;
     }
 
+    buf = *save;
+    token[0] = '\0';
     if (buf == NULL)
     {
         return NULL;
     }
     
     index = 0;
+    c = '\0';
     state = S_TRIM;
-    while (state != S_DONE && index < size)
+    while (state != S_DONE && index < size - 1)
     {
-        c = buf[pos]; pos++;
+        c = *buf;
+        if (c != '\0')
+        {
+            buf++;
+        }
         switch (state)
         {
             case S_TRIM: /*clearing leading whitespace*/
@@ -47,6 +80,7 @@ char * StringToken(char * buffer, char* token,int size)
                     case ' ':
                     case '\n':
                     case '\t':
+                    case '\r':
                         state = S_TRIM;
                         break;
                     case '"':
@@ -54,8 +88,8 @@ char * StringToken(char * buffer, char* token,int size)
                         break;
                     case '\0':
                         token[index] = '\0';
-                        state = S_DONE;
-                        break;
+                        *save = buf;
+                        return NULL;
                     default:
                         state = S_TOKEN;
                         token[index] = c;
@@ -72,8 +106,8 @@ char * StringToken(char * buffer, char* token,int size)
                     case ' ':
                     case '\t':
                     case '\n':
+                    case '\r':
                     case '\0':
-                        token[index] = '\0';
                         state = S_DONE;
                         break;
                     default:
@@ -87,7 +121,6 @@ char * StringToken(char * buffer, char* token,int size)
                 {
                     case '\0':
                     case '"':
-                        token[index] = '\0';
                         state = S_DONE;
                         break;
                     default:
@@ -98,8 +131,9 @@ char * StringToken(char * buffer, char* token,int size)
                 break;
         }
     }
-
-    return  (c == '\0') ? NULL : buf + pos;
+    token[index] = '\0';
+    *save = buf;
+    return buf;
 }
 
 /**
@@ -226,3 +260,953 @@ int ReadLine(FILE *fp,char *buffer,int size)
     buffer[index] = '\0';
     return (c == EOF);
 }
+
+
+/**
+ * @brief skips over a number of tokens in the input file stream.
+ * @details Tokens are contiguous sequences of non-whitespace characters,
+ * comment lines are ignored. Nothing is copied, so this is much cheaper 
+ * than repeated calls to NextToken() when the token values are not needed.
+ * @param fp the input file stream
+ * @param n the number of tokens to skip
+ * @return 1 if EOF is reached before n tokens are skipped
+ */
+int SkipTokens(FILE *fp,size_t n)
+{
+    int c;
+    unsigned char state;
+    state = S_TRIM;
+    while (n > 0)
+    {
+        c = getc_unlocked(fp);
+        switch (c)
+        {
+            case EOF:
+                return (state == S_TOKEN && n == 1) ? 0 : 1;
+            case ' ':
+            case '\n':
+            case '\t':
+            case '\r':
+                if (state == S_TOKEN)
+                {
+                    n--;
+                    state = S_TRIM;
+                }
+                else if (state == S_COMMENT && c == '\n')
+                {
+                    state = S_TRIM;
+                }
+                break;
+            case '#':
+                if (state == S_TRIM)
+                {
+                    state = S_COMMENT;
+                }
+                break;
+            default:
+                if (state == S_TRIM)
+                {
+                    state = S_TOKEN;
+                }
+                break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief maps a whole file into memory for reading.
+ * @details The file is mapped read only with mmap(). If the file cannot be
+ * mapped (e.g., it is empty or not a regular file) it is read into a heap
+ * buffer instead, so callers only ever deal with a pointer and a size.
+ * @param mf the mapped file descriptor to initialise
+ * @param filename the file to map
+ * @return 0 on success, 1 if the file could not be opened or read
+ */
+int MapFile(mappedFile *mf,const char *filename)
+{
+    int fd;
+    struct stat st;
+    mf->data = NULL;
+    mf->size = 0;
+    mf->isMapped = 0;
+
+    fd = open(filename,O_RDONLY);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    if (fstat(fd,&st) != 0)
+    {
+        close(fd);
+        return 1;
+    }
+
+    mf->size = (size_t)st.st_size;
+    if (mf->size > 0 && S_ISREG(st.st_mode))
+    {
+        void *addr;
+        addr = mmap(NULL,mf->size,PROT_READ,MAP_PRIVATE,fd,0);
+        if (addr != MAP_FAILED)
+        {
+            madvise(addr,mf->size,MADV_SEQUENTIAL);
+            mf->data = (char *)addr;
+            mf->isMapped = 1;
+            close(fd);
+            return 0;
+        }
+    }
+
+    // fall back to reading the file
+    {
+        FILE *fp;
+        size_t capacity;
+        size_t n;
+        fp = fdopen(fd,"rb");
+        if (fp == NULL)
+        {
+            close(fd);
+            return 1;
+        }
+        capacity = (mf->size > 0) ? mf->size : 4096;
+        mf->size = 0;
+        mf->data = (char *)malloc(capacity);
+        while (mf->data != NULL && (n = fread(mf->data + mf->size,1,capacity - mf->size,fp)) > 0)
+        {
+            mf->size += n;
+            if (mf->size == capacity)
+            {
+                char *tmp;
+                capacity *= 2;
+                tmp = (char *)realloc(mf->data,capacity);
+                if (tmp == NULL)
+                {
+                    free(mf->data);
+                }
+                mf->data = tmp;
+            }
+        }
+        fclose(fp);
+        return (mf->data == NULL);
+    }
+}
+
+/**
+ * @brief releases a file mapped with MapFile()
+ * @param mf the mapped file descriptor
+ * @return 0 on success
+ */
+int UnmapFile(mappedFile *mf)
+{
+    int rc;
+    rc = 0;
+    if (mf->data != NULL)
+    {
+        if (mf->isMapped)
+        {
+            rc = munmap((void *)mf->data,mf->size);
+        }
+        else
+        {
+            free(mf->data);
+        }
+    }
+    mf->data = NULL;
+    mf->size = 0;
+    return rc;
+}
+
+/**
+ * @brief drops the resident pages of a range of a mapped file
+ * @details The pages are read back from the file on the next access, so this
+ * only lowers the resident memory of data that has already been parsed. Only
+ * whole pages inside the range are dropped.
+ * @param mf the mapped file
+ * @param start offset of the first byte of the range
+ * @param end offset one past the last byte of the range
+ * @returns 0 on success, or -1 on error
+ */
+int ReleaseMappedRange(mappedFile *mf, size_t start, size_t end)
+{
+    size_t page;
+    if (!mf->isMapped || end > mf->size)
+    {
+        return 0;
+    }
+    page = (size_t)sysconf(_SC_PAGESIZE);
+    start = (start + page - 1) & ~(page - 1);
+    end = end & ~(page - 1);
+    if (start >= end)
+    {
+        return 0;
+    }
+    return madvise((void *)(mf->data + start),end - start,MADV_DONTNEED);
+}
+
+/**
+ * @brief finds the next token in a memory buffer.
+ * @details Same rules as NextToken(), but nothing is copied, the token is 
+ * returned as a span in the buffer. A token starting with " extends to the 
+ * closing " and the span excludes the quotes.
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the read cursor, advanced past the token and its delimiter
+ * @param token set to the start of the token
+ * @param length set to the number of bytes in the token
+ * @retVal 0 a token was found
+ * @retVal 1 the end of the buffer was reached first
+ */
+int MemNextToken(const char *buf,size_t size,size_t *pos,const char **token,size_t *length)
+{
+    size_t p;
+    size_t start;
+    p = *pos;
+    // clear leading whitespace and comments
+    while (p < size)
+    {
+        char c = buf[p];
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r')
+        {
+            p++;
+        }
+        else if (c == '#')
+        {
+            while (p < size && buf[p] != '\n')
+            {
+                p++;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (p >= size)
+    {
+        *pos = p;
+        *length = 0;
+        return 1;
+    }
+
+    if (buf[p] == '"')
+    {
+        p++;
+        start = p;
+        while (p < size && buf[p] != '"')
+        {
+            p++;
+        }
+        *token = buf + start;
+        *length = p - start;
+    }
+    else
+    {
+        start = p;
+        while (p < size && buf[p] != ' ' && buf[p] != '\n' && buf[p] != '\t' && buf[p] != '\r')
+        {
+            p++;
+        }
+        *token = buf + start;
+        *length = p - start;
+    }
+    // consume the delimiter
+    *pos = (p < size) ? p + 1 : p;
+    return 0;
+}
+
+/**
+ * @brief copies the next line in a memory buffer.
+ * @details Behaves like ReadLine(), it keeps copying until \n, the end of 
+ * the buffer, or linesize-1 chars (leaving room for the terminator).
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the read cursor, advanced to the start of the next line
+ * @param line the output line buffer
+ * @param linesize the size of line
+ * @return 1 if the end of the buffer is reached
+ */
+int MemReadLine(const char *buf,size_t size,size_t *pos,char *line,int linesize)
+{
+    size_t p;
+    int index;
+    p = *pos;
+    index = 0;
+    while (p < size && buf[p] != '\n' && index < linesize - 1)
+    {
+        line[index] = buf[p];
+        index++;
+        p++;
+    }
+    line[index] = '\0';
+    if (p < size && buf[p] == '\n')
+    {
+        *pos = p + 1;
+        return 0;
+    }
+    *pos = p;
+    return (p >= size);
+}
+
+/**
+ * @brief skips over a number of tokens in a memory buffer.
+ * @details The memory buffer equivalent of SkipTokens().
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the read cursor, advanced past the last skipped token
+ * @param n the number of tokens to skip
+ * @return 1 if the end of the buffer is reached before n tokens are skipped
+ */
+int MemSkipTokens(const char *buf,size_t size,size_t *pos,size_t n)
+{
+    size_t p;
+    p = *pos;
+    while (n > 0)
+    {
+        // leading whitespace and comments
+        while (p < size)
+        {
+            char c = buf[p];
+            if (c == ' ' || c == '\n' || c == '\t' || c == '\r')
+            {
+                p++;
+            }
+            else if (c == '#')
+            {
+                while (p < size && buf[p] != '\n')
+                {
+                    p++;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (p >= size)
+        {
+            *pos = p;
+            return 1;
+        }
+        // the token itself
+        while (p < size && buf[p] != ' ' && buf[p] != '\n' && buf[p] != '\t' && buf[p] != '\r')
+        {
+            p++;
+        }
+        n--;
+    }
+    *pos = p;
+    return 0;
+}
+
+/**
+ * @brief counts the tokens in a memory buffer.
+ * @details Uses the same rules as MemSkipTokens(), whitespace separated
+ * tokens with comment lines ignored.
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the offset to start counting from
+ * @return the number of tokens between pos and size
+ */
+size_t CountTokens(const char *buf,size_t size,size_t pos)
+{
+    size_t n;
+    int inToken;
+    n = 0;
+    inToken = 0;
+    while (pos < size)
+    {
+        char c = buf[pos];
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r')
+        {
+            inToken = 0;
+        }
+        else if (c == '#' && !inToken)
+        {
+            while (pos < size && buf[pos] != '\n')
+            {
+                pos++;
+            }
+            continue;
+        }
+        else if (!inToken)
+        {
+            inToken = 1;
+            n++;
+        }
+        pos++;
+    }
+    return n;
+}
+
+// powers of ten that are exactly representable as floats and doubles
+static const float pow10f[] = {1e0f,1e1f,1e2f,1e3f,1e4f,1e5f,1e6f,1e7f,1e8f,1e9f,1e10f};
+static const double pow10d[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,
+                                1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+#define IS_SPACE(c) ((c) == ' ' || (c) == '\n' || (c) == '\t' || (c) == '\r')
+#define IS_DIGIT(c) ((unsigned char)((c) - '0') < 10)
+
+/**
+ * @brief converts a decimal significand and exponent to the nearest float.
+ * @details Only handles cases where the result is guaranteed to be correctly
+ * rounded: either both operands are exact floats (a single rounding), or 
+ * both are exact doubles and the double result is not on a float rounding 
+ * boundary (so the second rounding cannot differ from a direct one).
+ * @param m the decimal significand
+ * @param e the base 10 exponent
+ * @param value the output value
+ * @return 0 on success, 1 if the caller must fall back to strtof()
+ */
+static int DecimalToFloat(uint64_t m,int e,float *value)
+{
+    if (m == 0)
+    {
+        *value = 0.0f;
+        return 0;
+    }
+    if (m <= (1ULL << 24) && e >= -10 && e <= 10)
+    {
+        *value = (e >= 0) ? (float)m * pow10f[e] : (float)m / pow10f[-e];
+        return 0;
+    }
+    if (m < (1ULL << 53) && e >= -22 && e <= 22)
+    {
+        double d;
+        uint64_t bits;
+        d = (e >= 0) ? (double)m * pow10d[e] : (double)m / pow10d[-e];
+        if (d < FLT_MIN || d > FLT_MAX)
+        {
+            return 1;
+        }
+        memcpy(&bits,&d,sizeof(bits));
+        // the 29 bits dropped going to float form an exact half way pattern
+        if ((bits & 0x1FFFFFFFULL) == 0x10000000ULL)
+        {
+            return 1;
+        }
+        *value = (float)d;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief parses a bulk sequence of whitespace separated floats.
+ * @details This is intended for large data blocks, it works directly on the
+ * buffer without copying tokens. Plain decimal numbers (with optional 
+ * fraction and exponent) take a fast path, anything else (more than 19
+ * significant digits, nan, inf, hex floats, ...) is handed to strtof(), 
+ * so results are identical to scanf("%f").
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the read cursor, advanced past the last value and its delimiter
+ * @param values the output array
+ * @param n the number of values to read
+ * @return the number of values read, less than n if the buffer ended early
+ */
+size_t ParseFloats(const char *buf,size_t size,size_t *pos,float *values,size_t n)
+{
+    const char *p;
+    const char *end;
+    size_t i;
+    p = buf + *pos;
+    end = buf + size;
+    for (i=0;i<n;i++)
+    {
+        const char *start;
+        uint64_t m;
+        int e;
+        int digits;
+        int neg;
+        int ok;
+        // leading whitespace and comments
+        while (p < end && (IS_SPACE(*p) || *p == '#'))
+        {
+            if (*p == '#')
+            {
+                while (p < end && *p != '\n')
+                {
+                    p++;
+                }
+            }
+            else
+            {
+                p++;
+            }
+        }
+        if (p >= end)
+        {
+            break;
+        }
+
+        start = p;
+        m = 0;
+        e = 0;
+        digits = 0;
+        ok = 1;
+        neg = (*p == '-');
+        if (*p == '-' || *p == '+')
+        {
+            p++;
+        }
+        // skip leading zeros so they do not count as significant
+        while (p < end && *p == '0')
+        {
+            p++;
+            digits = 1;
+        }
+        while (p < end && IS_DIGIT(*p))
+        {
+            if (m < 1000000000000000000ULL)
+            {
+                m = m*10 + (*p - '0');
+            }
+            else
+            {
+                ok = 0;
+            }
+            digits++;
+            p++;
+        }
+        if (p < end && *p == '.')
+        {
+            p++;
+            if (m == 0)
+            {
+                while (p < end && *p == '0')
+                {
+                    p++;
+                    e--;
+                    digits = 1;
+                }
+            }
+            while (p < end && IS_DIGIT(*p))
+            {
+                if (m < 1000000000000000000ULL)
+                {
+                    m = m*10 + (*p - '0');
+                    e--;
+                }
+                else
+                {
+                    ok = 0;
+                }
+                digits++;
+                p++;
+            }
+        }
+        if (digits > 0 && p < end && (*p == 'e' || *p == 'E'))
+        {
+            int eneg;
+            int ev;
+            p++;
+            eneg = 0;
+            ev = 0;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                eneg = (*p == '-');
+                p++;
+            }
+            if (p >= end || !IS_DIGIT(*p))
+            {
+                ok = 0;
+            }
+            while (p < end && IS_DIGIT(*p))
+            {
+                if (ev < 10000)
+                {
+                    ev = ev*10 + (*p - '0');
+                }
+                p++;
+            }
+            e += eneg ? -ev : ev;
+        }
+
+        if (digits == 0 || (p < end && !IS_SPACE(*p)))
+        {
+            ok = 0;
+        }
+
+        if (!ok || DecimalToFloat(m,e,values + i) != 0)
+        {
+            // slow path, let the C library do it
+            char token[64];
+            size_t length;
+            p = start;
+            while (p < end && !IS_SPACE(*p))
+            {
+                p++;
+            }
+            length = p - start;
+            if (length >= sizeof(token))
+            {
+                length = sizeof(token) - 1;
+            }
+            memcpy(token,start,length);
+            token[length] = '\0';
+            values[i] = strtof(token,NULL);
+        }
+        else if (neg)
+        {
+            values[i] = -values[i];
+        }
+        // consume the delimiter
+        if (p < end)
+        {
+            p++;
+        }
+    }
+    *pos = p - buf;
+    return i;
+}
+
+/**
+ * @brief parses a bulk sequence of whitespace separated integers.
+ * @details The integer equivalent of ParseFloats(), values that do not fit
+ * in an int or are not plain decimal integers are handed to strtol().
+ * @param buf the input buffer
+ * @param size the number of bytes in buf
+ * @param pos the read cursor, advanced past the last value and its delimiter
+ * @param values the output array
+ * @param n the number of values to read
+ * @return the number of values read, less than n if the buffer ended early
+ */
+size_t ParseInts(const char *buf,size_t size,size_t *pos,int *values,size_t n)
+{
+    const char *p;
+    const char *end;
+    size_t i;
+    p = buf + *pos;
+    end = buf + size;
+    for (i=0;i<n;i++)
+    {
+        const char *start;
+        int64_t v;
+        int neg;
+        int digits;
+        while (p < end && (IS_SPACE(*p) || *p == '#'))
+        {
+            if (*p == '#')
+            {
+                while (p < end && *p != '\n')
+                {
+                    p++;
+                }
+            }
+            else
+            {
+                p++;
+            }
+        }
+        if (p >= end)
+        {
+            break;
+        }
+
+        start = p;
+        v = 0;
+        digits = 0;
+        neg = (*p == '-');
+        if (*p == '-' || *p == '+')
+        {
+            p++;
+        }
+        while (p < end && IS_DIGIT(*p) && digits < 10)
+        {
+            v = v*10 + (*p - '0');
+            digits++;
+            p++;
+        }
+        if (neg)
+        {
+            v = -v;
+        }
+        if (digits == 0 || (p < end && !IS_SPACE(*p)) || v > INT32_MAX || v < INT32_MIN)
+        {
+            char token[64];
+            size_t length;
+            p = start;
+            while (p < end && !IS_SPACE(*p))
+            {
+                p++;
+            }
+            length = p - start;
+            if (length >= sizeof(token))
+            {
+                length = sizeof(token) - 1;
+            }
+            memcpy(token,start,length);
+            token[length] = '\0';
+            v = strtol(token,NULL,10);
+        }
+        values[i] = (int)v;
+        if (p < end)
+        {
+            p++;
+        }
+    }
+    *pos = p - buf;
+    return i;
+}
+/**
+ * @brief multiplies by a power of ten
+ * @details Exact powers are used where possible, so the result is within a
+ * few ulps of the true product.
+ */
+static double ScalePow10(double x,int e)
+{
+    while (e > 22)
+    {
+        x *= 1e22;
+        e -= 22;
+    }
+    while (e < -22)
+    {
+        x /= 1e22;
+        e += 22;
+    }
+    return (e >= 0) ? x * pow10d[e] : x / pow10d[-e];
+}
+
+// relative error bound of ScalePow10(), with plenty of headroom
+#define FORMAT_MARGIN 1e-14
+
+/**
+ * @brief tests if m x 10^e reads back as the float target
+ * @details v = m x 10^e is compared with the rounding interval of the
+ * target, [lo,hi], where v, lo and hi are all given in the same scale. Only
+ * values too close to a bound to decide in double precision are parsed 
+ * exactly.
+ */
+static int RoundTrips(double v,double lo,double hi,uint64_t m,int e,float target)
+{
+    float f;
+    if (v > lo*(1.0 + FORMAT_MARGIN) && v < hi*(1.0 - FORMAT_MARGIN))
+    {
+        return 1;
+    }
+    if (v < lo*(1.0 - FORMAT_MARGIN) || v > hi*(1.0 + FORMAT_MARGIN))
+    {
+        return 0;
+    }
+    if (DecimalToFloat(m,e,&f) != 0)
+    {
+        char token[32];
+        snprintf(token,sizeof(token),"%llue%d",(unsigned long long)m,e);
+        f = strtof(token,NULL);
+    }
+    return f == target;
+}
+
+/**
+ * @brief writes the shortest decimal string that reads back as the same float
+ * @details Plain notation is used for decimal exponents from -4 to 8, 
+ * otherwise scientific notation, e.g., 0.1, 12.5, 3e+10, 1.17549435e-38. 
+ * At most 9 significant digits are ever needed. The result is not null 
+ * terminated.
+ * @param value the value to format
+ * @param out the output buffer, at least FORMAT_FLOAT_MAX_LENGTH bytes
+ * @return the number of characters written
+ */
+int FormatFloat(float value,char *out)
+{
+    uint32_t bits;
+    uint32_t nbits;
+    uint64_t dbits;
+    float a;
+    float neighbour;
+    double d;
+    double lo;
+    double hi;
+    double md;
+    double scale;
+    uint64_t m9;
+    uint64_t m;
+    uint64_t q;
+    int e10;
+    int e2;
+    int k;
+    int n;
+    int ndig;
+    int x;
+    int i;
+    char digits[20];
+
+    n = 0;
+    memcpy(&bits,&value,sizeof(bits));
+    if (bits & 0x80000000u)
+    {
+        out[n++] = '-';
+    }
+    bits &= 0x7FFFFFFFu;
+    if (bits >= 0x7F800000u)
+    {
+        if (bits > 0x7F800000u)
+        {
+            memcpy(out,"nan",3);
+            return 3;
+        }
+        memcpy(out + n,"inf",3);
+        return n + 3;
+    }
+    if (bits == 0)
+    {
+        out[n++] = '0';
+        return n;
+    }
+    memcpy(&a,&bits,sizeof(a));
+    d = (double)a;
+
+    // the interval of reals that round to a, midpoints are exact in double
+    nbits = bits - 1;
+    memcpy(&neighbour,&nbits,sizeof(neighbour));
+    lo = (d + (double)neighbour)/2.0;
+    nbits = bits + 1;
+    memcpy(&neighbour,&nbits,sizeof(neighbour));
+    hi = (nbits >= 0x7F800000u) ? d + (d - lo) : (d + (double)neighbour)/2.0;
+
+    // 9 significant digits, d ~ m9 x 10^(e10-8)
+    // estimate the decimal exponent from the binary one, it is e10 or e10+1
+    memcpy(&dbits,&d,sizeof(dbits));
+    e2 = (int)((dbits >> 52) & 0x7FF) - 1023;
+    e10 = (e2*78913) >> 18;
+    scale = ScalePow10(1.0,8 - e10);
+    md = d*scale;
+    if (md >= 999999999.5)
+    {
+        e10++;
+        scale = ScalePow10(1.0,8 - e10);
+        md = d*scale;
+    }
+    // 9 significant digits, d ~ m9 x 10^(e10-8)
+    m9 = (uint64_t)(md + 0.5);
+    // the rounding interval in the same scale
+    lo *= scale;
+    hi *= scale;
+
+    // find the fewest digits that still round trip. Candidates with i digits
+    // are multiples of q = 10^(9-i) either side of m9, and if one exists for
+    // i digits one exists for every longer length, so search downwards.
+    m = m9;
+    k = 9;
+    q = 10;
+    for (i=8;i>0;i--,q*=10)
+    {
+        uint64_t c;
+        int up;
+        c = m9 / q;
+        // prefer the nearer of the two candidates
+        up = (2*(m9 % q) >= q);
+        if (RoundTrips((double)((c + up)*q),lo,hi,c + up,e10 - i + 1,a))
+        {
+            m = c + up;
+        }
+        else if (RoundTrips((double)((c + !up)*q),lo,hi,c + !up,e10 - i + 1,a))
+        {
+            m = c + !up;
+        }
+        else
+        {
+            break;
+        }
+        k = i;
+    }
+    // value is m x 10^(e10 - k + 1), drop trailing zeros
+    x = e10 - k + 1;
+    while (m % 10 == 0)
+    {
+        m /= 10;
+        x++;
+    }
+    ndig = 0;
+    while (m > 0)
+    {
+        digits[ndig++] = '0' + (char)(m % 10);
+        m /= 10;
+    }
+    // decimal exponent of the leading digit
+    x += ndig - 1;
+
+    if (x >= -4 && x <= 8)
+    {
+        if (x < 0)
+        {
+            out[n++] = '0';
+            out[n++] = '.';
+            for (i=0;i<-x-1;i++)
+            {
+                out[n++] = '0';
+            }
+            for (i=ndig-1;i>=0;i--)
+            {
+                out[n++] = digits[i];
+            }
+        }
+        else
+        {
+            for (i=0;i<=x;i++)
+            {
+                out[n++] = (i < ndig) ? digits[ndig-1-i] : '0';
+            }
+            if (ndig > x + 1)
+            {
+                out[n++] = '.';
+                for (i=x+1;i<ndig;i++)
+                {
+                    out[n++] = digits[ndig-1-i];
+                }
+            }
+        }
+    }
+    else
+    {
+        out[n++] = digits[ndig-1];
+        if (ndig > 1)
+        {
+            out[n++] = '.';
+            for (i=ndig-2;i>=0;i--)
+            {
+                out[n++] = digits[i];
+            }
+        }
+        out[n++] = 'e';
+        out[n++] = (x < 0) ? '-' : '+';
+        x = (x < 0) ? -x : x;
+        out[n++] = '0' + (char)(x/10);
+        out[n++] = '0' + (char)(x%10);
+    }
+    return n;
+}
+
+/**
+ * @brief writes an integer in decimal
+ * @details The result is not null terminated.
+ * @param value the value to format
+ * @param out the output buffer, at least FORMAT_INT_MAX_LENGTH bytes
+ * @return the number of characters written
+ */
+int FormatInt(int value,char *out)
+{
+    char digits[12];
+    unsigned int u;
+    int n;
+    int ndig;
+    n = 0;
+    u = (unsigned int)value;
+    if (value < 0)
+    {
+        out[n++] = '-';
+        u = 0u - u;
+    }
+    ndig = 0;
+    do
+    {
+        digits[ndig++] = '0' + (char)(u % 10);
+        u /= 10;
+    } while (u > 0);
+    while (ndig > 0)
+    {
+        out[n++] = digits[--ndig];
+    }
+    return n;
+}
@@ -4,6 +4,8 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define S_TRIM 1
 #define S_COMMENT 2
@@ -11,7 +13,35 @@
 #define S_TOKEN 4
 #define S_DONE 5
 #define S_STRING 6
+
+/* output buffer sizes for FormatFloat() and FormatInt()*/
+#define FORMAT_FLOAT_MAX_LENGTH 24
+#define FORMAT_INT_MAX_LENGTH 12
+
+typedef struct mappedFile_struct mappedFile;
+
+/*read only view of a whole file*/
+struct mappedFile_struct {
+    char *data;
+    size_t size;
+    int isMapped; // 0 if data was read into a heap buffer instead
+};
+
 char * StringToken(char * buffer, char* token,int size);
+char * StringTokenR(char * buffer, char* token,int size, char **save);
 int NextToken(FILE *fp,char * buffer, int size);
 int ReadLine(FILE *fp,char *buffer,int size);
+int SkipTokens(FILE *fp,size_t n);
+
+int MapFile(mappedFile *mf,const char *filename);
+int UnmapFile(mappedFile *mf);
+int ReleaseMappedRange(mappedFile *mf, size_t start, size_t end);
+int MemNextToken(const char *buf,size_t size,size_t *pos,const char **token,size_t *length);
+int MemReadLine(const char *buf,size_t size,size_t *pos,char *line,int linesize);
+int MemSkipTokens(const char *buf,size_t size,size_t *pos,size_t n);
+size_t CountTokens(const char *buf,size_t size,size_t pos);
+size_t ParseFloats(const char *buf,size_t size,size_t *pos,float *values,size_t n);
+size_t ParseInts(const char *buf,size_t size,size_t *pos,int *values,size_t n);
+int FormatFloat(float value,char *out);
+int FormatInt(int value,char *out);
 #endif
@@ -0,0 +1,113 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+typedef struct parallelJob_struct parallelJob;
+
+struct parallelJob_struct {
+    parallelTask task;
+    void *ctx;
+    size_t numTasks;
+    size_t next; // next task to hand out, updated atomically
+};
+
+/**
+ * @brief worker loop, claims tasks until none remain
+ */
+static void * ParallelWorker(void *arg)
+{
+    parallelJob *job;
+    size_t t;
+    job = (parallelJob *)arg;
+    while ((t = __sync_fetch_and_add(&(job->next),1)) < job->numTasks)
+    {
+        job->task(job->ctx,t);
+    }
+    return NULL;
+}
+
+/**
+ * @brief runs task(ctx,i) for i = 0,...,numTasks-1 on up to numThreads threads
+ * @details The calling thread takes part in the work. Tasks are claimed one at
+ * a time, so the order of completion is not defined and tasks must not depend
+ * on each other. If threads cannot be created the remaining work is done by 
+ * the calling thread.
+ * @param numThreads the maximum number of threads to use
+ * @param numTasks the number of tasks
+ * @param task the task function
+ * @param ctx shared context passed to every task
+ * @returns PARALLEL_SUCCESS once all tasks are complete
+ */
+int ParallelFor(int numThreads, size_t numTasks, parallelTask task, void *ctx)
+{
+    parallelJob job;
+    pthread_t *threads;
+    int i;
+    int numStarted;
+
+    job.task = task;
+    job.ctx = ctx;
+    job.numTasks = numTasks;
+    job.next = 0;
+
+    if (numThreads > numTasks)
+    {
+        numThreads = (int)numTasks;
+    }
+
+    threads = NULL;
+    numStarted = 0;
+    if (numThreads > 1)
+    {
+        threads = (pthread_t *)malloc((numThreads-1)*sizeof(pthread_t));
+    }
+    if (threads != NULL)
+    {
+        for (i=0;i<numThreads-1;i++)
+        {
+            if (pthread_create(threads + i,NULL,ParallelWorker,&job) != 0)
+            {
+                break;
+            }
+            numStarted++;
+        }
+    }
+
+    ParallelWorker(&job);
+
+    for (i=0;i<numStarted;i++)
+    {
+        pthread_join(threads[i],NULL);
+    }
+    free(threads);
+    return PARALLEL_SUCCESS;
+}
+
+/**
+ * @brief gets the number of online processors
+ * @returns the number of processors, at least 1
+ */
+int GetNumProcessors(void)
+{
+    long n;
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
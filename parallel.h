@@ -0,0 +1,42 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file parallel.h
+ * @brief Minimal thread helpers shared by the reader and writer
+ * 
+ * @details Work is expressed as a number of independent tasks that are 
+ * handed out dynamically to a fixed set of threads, so uneven tasks are
+ * balanced automatically.
+ *
+ * @author David J. Warne (david.warne@qut.edu.au)
+ * @author High Performance Computing and Research Support
+ * @author Queensland University of Technology
+ *
+ */
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <stddef.h>
+
+#define PARALLEL_SUCCESS 1
+#define PARALLEL_ERROR 0
+
+typedef void (*parallelTask)(void *ctx, size_t task);
+
+int ParallelFor(int numThreads, size_t numTasks, parallelTask task, void *ctx);
+int GetNumProcessors(void);
+#endif
@@ -16,6 +16,570 @@
  */
 
 #include "vtkFileWriter.h"
+
+/**
+ * @brief writes 32 bit words to a file in big endian order
+ * @details The words are swapped into a staging buffer chunk by chunk and 
+ * the buffer is written out, so the input is read once and never modified.
+ * @param fp the output file stream
+ * @param data the words to write in host order
+ * @param n the number of words
+ * @returns VTK_SUCCESS or VTK_FILE_ERROR
+ */
+static int WriteBE32(FILE *fp, const void *data, size_t n)
+{
+    uint32_t stage[VTK_STAGING_BUFFER_SIZE/sizeof(uint32_t)];
+    const uint32_t *src;
+    size_t m;
+
+    src = (const uint32_t *)data;
+    while (n > 0)
+    {
+        m = (n < VTK_STAGING_BUFFER_SIZE/sizeof(uint32_t)) ? n : VTK_STAGING_BUFFER_SIZE/sizeof(uint32_t);
+        HostToBig32(stage,src,m);
+        if (fwrite((void *)stage,sizeof(uint32_t),m,fp) != m)
+        {
+            return VTK_FILE_ERROR;
+        }
+        src += m;
+        n -= m;
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief copies a byte range of a source file to the end of a file stream
+ * @details The bytes go from file to file with copy_file_range(), without 
+ * passing through user space. If the kernel can not do that for this pair 
+ * of files (e.g., the output is a pipe) then a pread()/write() loop through
+ * a staging buffer is used instead.
+ * @param fp the output file stream
+ * @param source the file and offset to copy from
+ * @param n the number of bytes to copy
+ * @returns VTK_SUCCESS, VTK_FILE_NOT_FOUND_ERROR or VTK_FILE_ERROR
+ */
+int CopySource(FILE *fp, const vtkSource *source, size_t n)
+{
+    int in;
+    int out;
+    loff_t pos;
+    ssize_t len;
+    char buf[VTK_STAGING_BUFFER_SIZE];
+
+    if (fflush(fp) != 0)
+    {
+        return VTK_FILE_ERROR;
+    }
+    in = open(source->filename,O_RDONLY);
+    if (in < 0)
+    {
+        return VTK_FILE_NOT_FOUND_ERROR;
+    }
+    out = fileno(fp);
+    pos = source->offset;
+
+    while (n > 0)
+    {
+        len = copy_file_range(in,&pos,out,NULL,n,0);
+        if (len <= 0)
+        {
+            break;
+        }
+        n -= len;
+    }
+
+    // fall back to copying through user space
+    while (n > 0)
+    {
+        ssize_t done;
+        len = pread(in,buf,(n < sizeof(buf)) ? n : sizeof(buf),pos);
+        if (len <= 0)
+        {
+            break;
+        }
+        for (done = 0;done < len;)
+        {
+            ssize_t w = write(out,buf + done,len - done);
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                close(in);
+                return VTK_FILE_ERROR;
+            }
+            done += w;
+        }
+        pos += len;
+        n -= len;
+    }
+    close(in);
+    // a short source file is an error
+    return (n == 0) ? VTK_SUCCESS : VTK_FILE_ERROR;
+}
+
+/**
+ * @brief writes a cell list (vertex count followed by vertices) in big endian
+ * @details Same staging as WriteBE32(), the counts are interleaved with the 
+ * vertices while filling the buffer.
+ * @param fp the output file stream
+ * @param numVerts the vertex count of each cell
+ * @param cells the vertices of all cells, concatenated
+ * @param numCells the number of cells
+ * @returns VTK_SUCCESS or VTK_FILE_ERROR
+ */
+static int WriteCellsBE32(FILE *fp, const int *numVerts, const int *cells, int numCells)
+{
+    uint32_t stage[VTK_STAGING_BUFFER_SIZE/sizeof(uint32_t)] = {0};
+    size_t m;
+    int i,j,t;
+
+    m = 0;
+    t = 0;
+    for (i=0;i<numCells;i++)
+    {
+        for (j=-1;j<numVerts[i];j++)
+        {
+            if (m == VTK_STAGING_BUFFER_SIZE/sizeof(uint32_t))
+            {
+                HostToBig32(stage,stage,m);
+                if (fwrite((void *)stage,sizeof(uint32_t),m,fp) != m)
+                {
+                    return VTK_FILE_ERROR;
+                }
+                m = 0;
+            }
+            stage[m++] = (uint32_t)((j < 0) ? numVerts[i] : cells[t++]);
+        }
+    }
+    // the last, partly filled, staging buffer
+    if (m > 0)
+    {
+        HostToBig32(stage,stage,m);
+        if (fwrite((void *)stage,sizeof(uint32_t),m,fp) != m)
+        {
+            return VTK_FILE_ERROR;
+        }
+    }
+    return VTK_SUCCESS;
+}
+typedef struct textJob_struct textJob;
+
+/* text output in progress. Items (values, or cells when numVerts is set) are
+ * split into ranges that are formatted concurrently, each into its own 
+ * buffer, and the buffers are then written in order.*/
+struct textJob_struct {
+    const void *values; // values to format, when numVerts is NULL
+    int type; // VTK_INT or VTK_FLOAT
+    int perLine; // values on each line
+    const int *numVerts; // vertex count of each cell
+    const int *cells; // vertices of all cells, concatenated
+    int numRanges; // ranges in the current round
+    size_t *first; // first item of each range, numRanges+1 entries
+    size_t *offset; // cells only, index in cells of the first vertex
+    char **bufs; // VTK_TEXT_BUFFER_SIZE buffer for each range
+    size_t *lens; // bytes formatted into each buffer
+};
+
+/**
+ * @brief releases the text buffers of a file
+ * @param text the text buffers
+ */
+static void FreeTextBuffers(vtkTextBuffers *text)
+{
+    int r;
+    if (text->bufs != NULL)
+    {
+        for (r=0;r<text->maxRanges;r++)
+        {
+            free(text->bufs[r]);
+        }
+    }
+    free(text->bufs);
+    free(text->first);
+    free(text->offset);
+    free(text->lens);
+    text->bufs = NULL;
+    text->first = NULL;
+    text->offset = NULL;
+    text->lens = NULL;
+}
+
+/**
+ * @brief formats one range of a text job into its buffer
+ * @details Values keep their global position, so line breaks are the same
+ * however the items are split.
+ */
+static void FormatTextTask(void *ctx, size_t r)
+{
+    textJob *job;
+    char *buf;
+    size_t len;
+    size_t i;
+
+    job = (textJob *)ctx;
+    buf = job->bufs[r];
+    len = 0;
+    if (job->numVerts == NULL)
+    {
+        for (i=job->first[r];i<job->first[r+1];i++)
+        {
+            if (job->type == VTK_FLOAT)
+            {
+                len += FormatFloat(((const float *)job->values)[i],buf + len);
+            }
+            else
+            {
+                len += FormatInt(((const int *)job->values)[i],buf + len);
+            }
+            buf[len++] = ((i + 1) % job->perLine == 0) ? '\n' : ' ';
+        }
+    }
+    else
+    {
+        size_t t;
+        int j;
+        t = job->offset[r];
+        for (i=job->first[r];i<job->first[r+1];i++)
+        {
+            len += FormatInt(job->numVerts[i],buf + len);
+            for (j=0;j<job->numVerts[i];j++)
+            {
+                buf[len++] = ' ';
+                len += FormatInt(job->cells[t++],buf + len);
+            }
+            buf[len++] = '\n';
+        }
+    }
+    job->lens[r] = len;
+}
+
+/**
+ * @brief formats and writes the items of a text job
+ * @details Each round the items are split serially into ranges that fit a
+ * VTK_TEXT_BUFFER_SIZE buffer, up to 4 ranges per thread, which are then 
+ * formatted in parallel and written in order. Memory use is bounded by the
+ * buffers regardless of the number of items. The buffers are kept with 
+ * the file, so later arrays and windows reuse them.
+ * @param fp the output file stream
+ * @param job the text job, with the input fields set
+ * @param numItems the number of values or cells
+ * @param text the text buffers of the file
+ * @returns VTK_SUCCESS, VTK_MEMORY_ERROR, VTK_NOT_SUPPORTED_ERROR or
+ * VTK_FILE_ERROR
+ */
+static int WriteText(FILE *fp, textJob *job, size_t numItems, vtkTextBuffers *text)
+{
+    int r;
+    int rc;
+    size_t item;
+    size_t t;
+    size_t maxValues;
+
+    if (text->bufs == NULL)
+    {
+        text->maxRanges = (text->numThreads > 1) ? 4*text->numThreads : 1;
+        text->first = (size_t *)malloc((text->maxRanges + 1)*sizeof(size_t));
+        text->offset = (size_t *)malloc(text->maxRanges*sizeof(size_t));
+        text->lens = (size_t *)malloc(text->maxRanges*sizeof(size_t));
+        text->bufs = (char **)calloc(text->maxRanges,sizeof(char *));
+        if (text->first == NULL || text->offset == NULL || text->lens == NULL || text->bufs == NULL)
+        {
+            FreeTextBuffers(text);
+            return VTK_MEMORY_ERROR;
+        }
+    }
+    job->first = text->first;
+    job->offset = text->offset;
+    job->lens = text->lens;
+    job->bufs = text->bufs;
+    maxValues = VTK_TEXT_BUFFER_SIZE/(FORMAT_FLOAT_MAX_LENGTH + 1);
+    rc = VTK_SUCCESS;
+
+    item = 0;
+    t = 0;
+    while (rc == VTK_SUCCESS && item < numItems)
+    {
+        // plan the ranges of this round
+        for (r=0;r<text->maxRanges && item < numItems;r++)
+        {
+            if (job->bufs[r] == NULL && (job->bufs[r] = (char *)malloc(VTK_TEXT_BUFFER_SIZE)) == NULL)
+            {
+                rc = VTK_MEMORY_ERROR;
+                break;
+            }
+            job->first[r] = item;
+            job->offset[r] = t;
+            if (job->numVerts == NULL)
+            {
+                item += (numItems - item < maxValues) ? numItems - item : maxValues;
+            }
+            else
+            {
+                size_t used;
+                used = 0;
+                while (item < numItems && used + (1 + (size_t)(job->numVerts[item]))*(FORMAT_INT_MAX_LENGTH + 1) <= VTK_TEXT_BUFFER_SIZE)
+                {
+                    used += (1 + (size_t)(job->numVerts[item]))*(FORMAT_INT_MAX_LENGTH + 1);
+                    t += job->numVerts[item];
+                    item++;
+                }
+                if (item == job->first[r])
+                {
+                    // a single cell larger than the buffer
+                    rc = VTK_NOT_SUPPORTED_ERROR;
+                    break;
+                }
+            }
+        }
+        if (rc != VTK_SUCCESS)
+        {
+            break;
+        }
+        job->numRanges = r;
+        job->first[r] = item;
+
+        ParallelFor(text->numThreads,job->numRanges,FormatTextTask,job);
+
+        for (r=0;r<job->numRanges;r++)
+        {
+            if (fwrite(job->bufs[r],1,job->lens[r],fp) != job->lens[r])
+            {
+                rc = VTK_FILE_ERROR;
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+/**
+ * @brief writes numbers as text, perLine values to a line
+ * @details Values are formatted with FormatFloat() or FormatInt(), so stdio
+ * does no formatting, and floats are written with the fewest digits that 
+ * read back to the same value. Large arrays are formatted on up to 
+ * text->numThreads threads, see WriteText().
+ * @param fp the output file stream
+ * @param values the values
+ * @param type VTK_INT or VTK_FLOAT
+ * @param n the number of values
+ * @param perLine the number of values on each line
+ * @param text the text buffers of the file
+ * @returns VTK_SUCCESS, VTK_MEMORY_ERROR or VTK_FILE_ERROR
+ */
+static int WriteValuesText(FILE *fp, const void *values, int type, size_t n, int perLine, vtkTextBuffers *text)
+{
+    textJob job;
+    job.values = values;
+    job.type = type;
+    job.perLine = perLine;
+    job.numVerts = NULL;
+    job.cells = NULL;
+    return WriteText(fp,&job,n,text);
+}
+
+/**
+ * @brief writes a cell list (vertex count followed by vertices) as text
+ * @details One cell per line, formatted as in WriteValuesText().
+ * @param fp the output file stream
+ * @param numVerts the vertex count of each cell
+ * @param cells the vertices of all cells, concatenated
+ * @param numCells the number of cells
+ * @param text the text buffers of the file
+ * @returns VTK_SUCCESS, VTK_MEMORY_ERROR, VTK_NOT_SUPPORTED_ERROR or 
+ * VTK_FILE_ERROR
+ */
+static int WriteCellsText(FILE *fp, const int *numVerts, const int *cells, int numCells, vtkTextBuffers *text)
+{
+    textJob job;
+    job.values = NULL;
+    job.type = VTK_INT;
+    job.perLine = 1;
+    job.numVerts = numVerts;
+    job.cells = cells;
+    return WriteText(fp,&job,numCells,text);
+}
+
+/**
+ * @brief writes a single float with a leading space
+ */
+static void WriteFloatField(FILE *fp, float value)
+{
+    char buf[FORMAT_FLOAT_MAX_LENGTH + 1];
+    int n;
+    buf[0] = ' ';
+    n = FormatFloat(value,buf + 1);
+    fwrite(buf,1,n + 1,fp);
+}
+
+/**
+ * @brief reads n values of a source into a buffer in host order
+ * @details Computed values are expanded instead of read.
+ * @param fd the open source file, unused if the source has an expand function
+ * @param source the source the values are read from
+ * @param first index of the first value
+ * @param n the number of values
+ * @param buf output buffer of at least n values
+ * @returns VTK_SUCCESS or VTK_FILE_ERROR if the source is too short
+ */
+int ReadSource(int fd, const vtkSource *source, size_t first, size_t n, void *buf)
+{
+    size_t done;
+    ssize_t len;
+    off_t pos;
+
+    if (source->expand != NULL)
+    {
+        return source->expand(source->ctx,first,n,buf);
+    }
+    pos = source->offset + (off_t)first*4;
+    for (done = 0;done < n*4;done += len)
+    {
+        len = pread(fd,(char *)buf + done,n*4 - done,pos + done);
+        if (len < 0 && errno == EINTR)
+        {
+            len = 0;
+            continue;
+        }
+        if (len <= 0)
+        {
+            return VTK_FILE_ERROR;
+        }
+    }
+    if (source->bigEndian)
+    {
+        BigToHost32(buf,buf,n);
+    }
+    else
+    {
+        LittleToHost32(buf,buf,n);
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief writes the values of a source, reading them one window at a time
+ * @details Values already in the output byte order (big endian for binary, 
+ * host order for XML) are copied file to file, otherwise the values are 
+ * read with pread() into a window of at most budget bytes, which is 
+ * converted and written before the next is read, so the memory used does 
+ * not depend on the number of values. Computed values are expanded into 
+ * the same window.
+ * @param fp the output file stream
+ * @param source the file the values are kept in, or how they are computed
+ * @param type the value type, VTK_INT or VTK_FLOAT
+ * @param n the number of values
+ * @param perLine values per line of ASCII output
+ * @param format the output format, VTK_ASCII, VTK_BINARY or VTK_XML
+ * @param budget the maximum number of bytes to read at a time
+ * @param text the text buffers of the file, used for ASCII output
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int WriteSource(FILE *fp, const vtkSource *source, int type, size_t n, int perLine, char format, size_t budget, vtkTextBuffers *text)
+{
+    int fd;
+    int rc;
+    size_t i;
+    size_t m;
+    size_t window;
+    void *buf;
+
+    if (source->expand == NULL && format == VTK_BINARY && source->bigEndian)
+    {
+        return CopySource(fp,source,n*4);
+    }
+    if (source->expand == NULL && format == VTK_XML && source->bigEndian == (__BYTE_ORDER == __BIG_ENDIAN))
+    {
+        return CopySource(fp,source,n*4);
+    }
+
+    // whole lines per window, so ASCII line breaks do not move
+    window = budget/4;
+    window -= window % perLine;
+    if (window < (size_t)perLine)
+    {
+        window = perLine;
+    }
+    if (window > n)
+    {
+        window = n;
+    }
+    fd = -1;
+    if (source->expand == NULL)
+    {
+        fd = open(source->filename,O_RDONLY);
+        if (fd < 0)
+        {
+            return VTK_FILE_NOT_FOUND_ERROR;
+        }
+    }
+    buf = malloc(window*4);
+    if (buf == NULL)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return VTK_MEMORY_ERROR;
+    }
+
+    rc = VTK_SUCCESS;
+    for (i = 0;i < n && rc == VTK_SUCCESS;i += m)
+    {
+        m = (n - i < window) ? n - i : window;
+        rc = ReadSource(fd,source,i,m,buf);
+        if (rc != VTK_SUCCESS)
+        {
+            break;
+        }
+        if (format == VTK_ASCII)
+        {
+            rc = WriteValuesText(fp,buf,type,m,perLine,text);
+        }
+        else if (format == VTK_XML)
+        {
+            rc = (fwrite(buf,4,m,fp) == m) ? VTK_SUCCESS : VTK_FILE_ERROR;
+        }
+        else
+        {
+            rc = WriteBE32(fp,buf,m);
+        }
+    }
+    free(buf);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return rc;
+}
+
+/**
+ * @brief writes the values of a scalar or vector
+ * @param fp the output file stream
+ * @param values the values in host order, or NULL to read them from source
+ * @param source where the values are kept if values is NULL
+ * @param type the value type, VTK_INT or VTK_FLOAT
+ * @param n the number of values
+ * @param perLine values per line of ASCII output
+ * @param format the output format, VTK_ASCII or VTK_BINARY
+ * @param budget the maximum number of bytes to read from source at a time
+ * @param text the text buffers of the file, used for ASCII output
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+static int WriteValues(FILE *fp, const void *values, const vtkSource *source, int type, size_t n, int perLine, char format, size_t budget, vtkTextBuffers *text)
+{
+    if (values == NULL)
+    {
+        return WriteSource(fp,source,type,n,perLine,format,budget,text);
+    }
+    if (format == VTK_ASCII)
+    {
+        return WriteValuesText(fp,values,type,n,perLine,text);
+    }
+    return WriteBE32(fp,values,n);
+}
+
 /**
  * @brief Opens a vtk file for writing
  * @param file the vtk file object
@@ -29,15 +593,18 @@ int VTK_Open(vtkDataFile *file, char * filename)
     {
         return VTK_FILE_ERROR;
     }
+    // text buffers are allocated when the first ASCII array is written
+    memset(&(file->text),0,sizeof(vtkTextBuffers));
+    file->text.numThreads = file->numThreads;
+    return VTK_SUCCESS;
 }
 
 /**
- * @brief exports the vtk data file object to a file
+ * @brief writes the legacy header, title and data type lines
+ * @param file the vtk file object
  */
-int VTK_Write(vtkDataFile *file)
+static void WriteHeader(vtkDataFile *file)
 {
-    int rc;
-    // write the header and title
     fprintf(file->fp,"# vtk DataFile Version %s\n",file->vtkVersion);
     fprintf(file->fp,"%s",file->title);
     // print data type
@@ -49,20 +616,38 @@ int VTK_Write(vtkDataFile *file)
     {
         fprintf(file->fp,"BINARY\n");
     }
+}
+
+/**
+ * @brief exports the vtk data file object to a file
+ */
+int VTK_Write(vtkDataFile *file)
+{
+    int rc;
+    WriteHeader(file);
     // print data set
     fprintf(file->fp,"DATASET ");
     /** @todo abstract to sub functions */
     switch(file->geometry)
     {
         case VTK_POLYDATA:
-            rc = VTK_WritePolydata(file->fp,(polydata *)file->dataset,file->dataType);
+            rc = VTK_WritePolydata(file->fp,(polydata *)file->dataset,file->dataType,&(file->text));
             break;
         case VTK_UNSTRUCTURED_GRID:
-            rc = VTK_WriteUnstructuredGrid(file->fp,(unstructuredGrid *)file->dataset,file->dataType);
+            rc = VTK_WriteUnstructuredGrid(file->fp,(unstructuredGrid *)file->dataset,file->dataType,&(file->text));
             break;
         case VTK_STRUCTURED_POINTS:
             rc = VTK_WriteStructuredPoints(file->fp,(structuredPoints *)file->dataset,file->dataType);
             break;
+        case VTK_RECTILINEAR_GRID:
+            rc = VTK_WriteRectilinearGrid(file->fp,(rectilinearGrid *)file->dataset,file->dataType,&(file->text));
+            break;
+        case VTK_STRUCTURED_GRID:
+            rc = VTK_WriteStructuredGrid(file->fp,(structuredGrid *)file->dataset,file->dataType,&(file->text));
+            break;
+        default:
+            rc = VTK_NOT_SUPPORTED_ERROR;
+            break;
     }
 
     if (rc != VTK_SUCCESS)
@@ -74,13 +659,17 @@ int VTK_Write(vtkDataFile *file)
     if (file->pointdata->size > 0)
     {
         fprintf(file->fp,"\nPOINT_DATA ");
-        rc = VTK_WriteData(file->fp,file->pointdata,file->dataType);
+        rc = VTK_WriteData(file->fp,file->pointdata,file->dataType,&(file->text),file->memoryBudget);
+        if (rc != VTK_SUCCESS)
+        {
+            return rc;
+        }
     }
 
     if (file->celldata->size > 0)
     {
         fprintf(file->fp,"\nCELL_DATA ");
-        rc = VTK_WriteData(file->fp,file->celldata,file->dataType);
+        rc = VTK_WriteData(file->fp,file->celldata,file->dataType,&(file->text),file->memoryBudget);
     }
     if (rc != VTK_SUCCESS)
     {
@@ -94,27 +683,25 @@ int VTK_Write(vtkDataFile *file)
  * @param fp the file output stream
  * @param ug the unstructured grid
  * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
  */
-int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug, char type)
+int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug, char type, vtkTextBuffers *text)
 {
-    int i,j,t;
+    int i;
     int size;
+    int rc;
     fprintf(fp,"UNSTRUCTURED_GRID\n");
     fprintf(fp,"POINTS %d float\n",ug->numPoints);
     if (type == VTK_ASCII)
     {
-        for (i=0;i<(ug->numPoints);i++)
+        if ((rc = WriteValuesText(fp,ug->points,VTK_FLOAT,(size_t)(ug->numPoints)*3,3,text)) != VTK_SUCCESS)
         {
-            fprintf(fp,"%f %f %f\n",ug->points[i*3],ug->points[i*3+1],ug->points[i*3+2]);
+            return rc;
         }
     }
     else
     {
-        size_t n;
-        H2BE32(ug->points,ug->numPoints*3);
-        n = fwrite((void *)ug->points,sizeof(float),ug->numPoints*3,fp);
-        BE2H32(ug->points,ug->numPoints*3);
-        if (n != ug->numPoints*3)
+        if (WriteBE32(fp,ug->points,(size_t)(ug->numPoints)*3) != VTK_SUCCESS)
         {
             return VTK_FILE_ERROR;
         }
@@ -129,67 +716,29 @@ int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug, char type)
     fprintf(fp,"CELLS %d %d\n",ug->numCells,size);
     if (type == VTK_ASCII)
     {
-        t=0;
-        for (i=0;i<(ug->numCells);i++)
+        if ((rc = WriteCellsText(fp,ug->numVerts,ug->cells,ug->numCells,text)) != VTK_SUCCESS)
         {
-            fprintf(fp,"%d",ug->numVerts[i]);
-            for (j=t;j<(t+ug->numVerts[i]);j++)
-            {
-                fprintf(fp," %d",ug->cells[j]);
-            }
-            fprintf(fp,"\n");
-            t=j;
+            return rc;
         }
     }
     else 
     {
-        int *tmp_buffer = (int*)malloc(size*sizeof(int));
-        int ii;
-        size_t n;
-        if (tmp_buffer == NULL)
-        {
-            return VTK_MEMORY_ERROR;
-        }
-
-        t=0;
-        ii=0;
-        for (i=0;i<(ug->numCells);i++)
-        {
-            tmp_buffer[ii] = ug->numVerts[i];
-            ii++;
-            for (j=t;j<(t+ug->numVerts[i]);j++)
-            {
-                tmp_buffer[ii] = ug->cells[j];
-                ii++;   
-            }
-            t=j;
-        }
-        H2BE32(tmp_buffer,size);
-        n = fwrite((void*)tmp_buffer,sizeof(int),size,fp);
-        BE2H32(tmp_buffer,size);
-        free(tmp_buffer);
-        tmp_buffer = NULL;
-        if (n != size)
+        if (WriteCellsBE32(fp,ug->numVerts,ug->cells,ug->numCells) != VTK_SUCCESS)
         {
             return VTK_FILE_ERROR;
         }
-
     }
     fprintf(fp,"CELL_TYPES %d\n",ug->numCells);
     if (type == VTK_ASCII)
     {
-        for (i=0;i<(ug->numCells);i++)
+        if ((rc = WriteValuesText(fp,ug->cellTypes,VTK_INT,ug->numCells,1,text)) != VTK_SUCCESS)
         {
-            fprintf(fp,"%d\n",ug->cellTypes[i]);
+            return rc;
         }
     }
     else
     {
-        size_t n;
-        H2BE32(ug->cellTypes,ug->numCells);
-        n = fwrite((void*)ug->cellTypes,sizeof(int),ug->numCells,fp);
-        H2BE32(ug->cellTypes,ug->numCells);
-        if (n != ug->numCells)
+        if (WriteBE32(fp,ug->cellTypes,ug->numCells) != VTK_SUCCESS)
         {
             return VTK_FILE_ERROR;
         }
@@ -197,94 +746,81 @@ int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug, char type)
     return VTK_SUCCESS;
 }
 
+/**
+ * @brief writes a section of poly data cells, e.g., LINES or POLYGONS
+ * @param fp the file output stream
+ * @param keyword the section keyword
+ * @param numVerts the vertex count of each cell
+ * @param cells the vertices of all cells, concatenated
+ * @param numCells the number of cells
+ * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
+ */
+static int WriteCellSection(FILE *fp, const char *keyword, const int *numVerts, const int *cells, int numCells, char type, vtkTextBuffers *text)
+{
+    int i;
+    int size;
+    size = numCells;
+    for (i=0;i<numCells;i++)
+    {
+        size += numVerts[i];
+    }
+
+    fprintf(fp,"%s %d %d\n",keyword,numCells,size);
+    if (type == VTK_ASCII)
+    {
+        return WriteCellsText(fp,numVerts,cells,numCells,text);
+    }
+    if (WriteCellsBE32(fp,numVerts,cells,numCells) != VTK_SUCCESS)
+    {
+        return VTK_FILE_ERROR;
+    }
+    return VTK_SUCCESS;
+}
+
 /**
  * @brief writes a VTK poly data mesh to the file output stream
+ * @details Lines and polygons are written in their own sections, empty 
+ * sections are left out. Cell types follow from the sections.
  * @param fp the file output stream
  * @param pd the polydata mesh
  * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
  */
-int VTK_WritePolydata(FILE *fp,polydata *pd,char type)
+int VTK_WritePolydata(FILE *fp,polydata *pd,char type, vtkTextBuffers *text)
 {
-    int i,j,t;
-    int size;
+    int rc;
     fprintf(fp,"POLYDATA\n");
     /**@todo assert that points are floats */
     fprintf(fp,"POINTS %d float\n",pd->numPoints);
     if (type == VTK_ASCII)
     {
-        for (i=0;i<pd->numPoints;i++)
+        if ((rc = WriteValuesText(fp,pd->points,VTK_FLOAT,(size_t)(pd->numPoints)*3,3,text)) != VTK_SUCCESS)
         {
-            fprintf(fp,"%f %f %f\n",pd->points[i*3],pd->points[i*3+1],pd->points[i*3 +2]);
+            return rc;
         }
     }
     else
     {
-        size_t n;
-        uint32_t * buf32be;
-        H2BE32(pd->points,pd->numPoints*3);
-        n = fwrite((void*)pd->points,sizeof(float),pd->numPoints*3,fp);
-        BE2H32(pd->points,pd->numPoints*3);
-
-        if (n != pd->numPoints*3)
+        if (WriteBE32(fp,pd->points,(size_t)(pd->numPoints)*3) != VTK_SUCCESS)
         {
             return VTK_FILE_ERROR;
         }
     }
-    size = pd->numPolygons;
-    for (i=0;i<pd->numPolygons;i++)
-    {
-        size += pd->numVerts[i];
-    }
-            
-    fprintf(fp,"POLYGONS %d %d\n",pd->numPolygons,size);
-    if (type == VTK_ASCII)
+    if (pd->numLines > 0)
     {
-        t=0;
-        for (i=0;i<pd->numPolygons;i++)
+        rc = WriteCellSection(fp,"LINES",pd->numLineVerts,pd->lines,pd->numLines,type,text);
+        if (rc != VTK_SUCCESS)
         {
-            fprintf(fp,"%d",pd->numVerts[i]);
-            for (j=t;j<(t+pd->numVerts[i]);j++)
-            {
-                fprintf(fp," %d",pd->polygons[j]);
-            }
-            fprintf(fp,"\n");
-            t=j;
+            return rc;
         }
     }
-    else
+    if (pd->numPolygons > 0)
     {
-        int *tmp_buffer;
-        int ii;
-        size_t n;
-        uint32_t *buffer32;
-        tmp_buffer = (int*)malloc(size*sizeof(int));
-        if (tmp_buffer == NULL)
-        {
-            return VTK_MEMORY_ERROR;
-        }
-        
-        ii=0;
-        t=0;
-        for (i=0;i<pd->numPolygons;i++)
-        {
-            tmp_buffer[ii] = pd->numVerts[i];
-            ii++;
-            for (j=t;j<(t+pd->numVerts[i]);j++)
-            {
-                tmp_buffer[ii] = pd->polygons[j];
-                ii++;
-            }
-            t=j;
-        }
-
-        H2BE32(tmp_buffer,size);
-        n = fwrite((void*)tmp_buffer,sizeof(int),size,fp);
-        BE2H32(tmp_buffer,size);
-        free(tmp_buffer);
-        tmp_buffer = NULL;
-        if (n != size)
+        rc = WriteCellSection(fp,"POLYGONS",pd->numVerts,pd->polygons,pd->numPolygons,type,text);
+        if (rc != VTK_SUCCESS)
         {
-            return VTK_FILE_ERROR;
+            return rc;
         }
     }
     return VTK_SUCCESS;
@@ -309,12 +845,90 @@ int VTK_WriteStructuredPoints(FILE *fp,structuredPoints *sp,char type)
     fprintf(fp,"\nORIGIN");
     for (i=0;i<VTK_DIM;i++)
     {
-        fprintf(fp," %f",sp->origin[i]);
+        WriteFloatField(fp,sp->origin[i]);
     }
     fprintf(fp,"\nSPACING");
     for (i=0;i<VTK_DIM;i++)
     {
-        fprintf(fp," %f",sp->spacing[i]);
+        WriteFloatField(fp,sp->spacing[i]);
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief writes a VTK rectilinear grid to the file output stream
+ * @details Only the coordinates along each axis are written, the points 
+ * are their product.
+ * @param fp the file output stream
+ * @param rg the rectilinear grid
+ * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
+ */
+int VTK_WriteRectilinearGrid(FILE *fp,rectilinearGrid *rg,char type,vtkTextBuffers *text)
+{
+    int i;
+    int rc;
+    const char *axes[VTK_DIM] = {"X","Y","Z"};
+    int num[VTK_DIM];
+    float *coordinates[VTK_DIM];
+
+    num[0] = rg->numX;
+    num[1] = rg->numY;
+    num[2] = rg->numZ;
+    coordinates[0] = rg->X_coordinates;
+    coordinates[1] = rg->Y_coordinates;
+    coordinates[2] = rg->Z_coordinates;
+    fprintf(fp,"RECTILINEAR_GRID\n");
+    fprintf(fp,"DIMENSIONS %d %d %d\n",rg->dimensions[0],rg->dimensions[1],rg->dimensions[2]);
+    for (i=0;i<VTK_DIM;i++)
+    {
+        fprintf(fp,"%s_COORDINATES %d float\n",axes[i],num[i]);
+        if (type == VTK_ASCII)
+        {
+            if ((rc = WriteValuesText(fp,coordinates[i],VTK_FLOAT,num[i],1,text)) != VTK_SUCCESS)
+            {
+                return rc;
+            }
+        }
+        else
+        {
+            if (WriteBE32(fp,coordinates[i],num[i]) != VTK_SUCCESS)
+            {
+                return VTK_FILE_ERROR;
+            }
+        }
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief writes a VTK structured grid to the file output stream
+ * @details The points are written with the dimensions of the grid, the 
+ * cells follow from the dimensions, so no connectivity is written.
+ * @param fp the file output stream
+ * @param sg the structured grid
+ * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
+ */
+int VTK_WriteStructuredGrid(FILE *fp,structuredGrid *sg,char type,vtkTextBuffers *text)
+{
+    int rc;
+    fprintf(fp,"STRUCTURED_GRID\n");
+    fprintf(fp,"DIMENSIONS %d %d %d\n",sg->dimensions[0],sg->dimensions[1],sg->dimensions[2]);
+    fprintf(fp,"POINTS %d float\n",sg->numPoints);
+    if (type == VTK_ASCII)
+    {
+        if ((rc = WriteValuesText(fp,sg->points,VTK_FLOAT,(size_t)(sg->numPoints)*3,3,text)) != VTK_SUCCESS)
+        {
+            return rc;
+        }
+    }
+    else
+    {
+        if (WriteBE32(fp,sg->points,(size_t)(sg->numPoints)*3) != VTK_SUCCESS)
+        {
+            return VTK_FILE_ERROR;
+        }
     }
     return VTK_SUCCESS;
 }
@@ -324,156 +938,201 @@ int VTK_WriteStructuredPoints(FILE *fp,structuredPoints *sp,char type)
  * @param fp the ouptut file stream
  * @param data the vtkData struct
  * @param type specifies write mode, either VTK_ASCII or VTK_BINARY
+ * @param text the text buffers of the file, used for ASCII output
+ * @param budget the maximum number of bytes read at a time from the source 
+ * of a scalar or vector that is not in memory
  */
-int VTK_WriteData(FILE *fp,vtkData *data,char type)
+int VTK_WriteData(FILE *fp,vtkData *data,char type, vtkTextBuffers *text, size_t budget)
 {
     int i;
+    int rc;
     fprintf(fp,"%d\n",data->size);
 #ifdef DEBUG
     printf("writing %d numScalars %d numVectors %d\n",data->size,data->numScalars,data->numVectors);
 #endif
     // write scalar data
-    if (type == VTK_ASCII)
+    for (i=0;i<(data->numScalars);i++)
+    {
+        scalar * sd;
+        sd = &(data->scalar_data[i]);
+        // print the header
+        switch (sd->type)
+        {
+            case VTK_INT:
+                fprintf(fp,"SCALARS %s int\nLOOKUP_TABLE default\n",sd->name);
+                break;
+            case VTK_FLOAT:
+                fprintf(fp,"SCALARS %s float\nLOOKUP_TABLE default\n",sd->name);
+                break;
+            default:
+                continue;
+        }
+        rc = WriteValues(fp,sd->data,&(sd->source),sd->type,data->size,1,type,budget,text);
+        if (rc != VTK_SUCCESS)
+        {
+            return rc;
+        }
+    }
+
+    // write vector data
+    for (i=0;i<(data->numVectors);i++)
+    {
+        vector *vd;
+        vd = &(data->vector_data[i]);
+        switch (vd->type)
+        {
+            case VTK_INT:
+                fprintf(fp,"VECTORS %s int\n",vd->name);
+                break;
+            case VTK_FLOAT:
+                fprintf(fp,"VECTORS %s float\n",vd->name);
+                break;
+            default:
+                continue;
+        }
+        rc = WriteValues(fp,vd->data,&(vd->source),vd->type,(size_t)(data->size)*VTK_DIM,VTK_DIM,type,budget,text);
+        if (rc != VTK_SUCCESS)
+        {
+            return rc;
+        }
+    }
+
+    return VTK_SUCCESS;
+}
+/**
+ * @brief closes the vtk file
+ * @details Buffered output is only written when the file is closed, so a
+ * write that fails late (e.g., the disk is full) is reported here.
+ * @param file the vtk file, opened with VTK_Open()
+ * @returns VTK_SUCCESS, or VTK_FILE_ERROR if any write to the file failed
+ */
+int VTK_Close(vtkDataFile*file)
+{
+    int failed;
+    FreeTextBuffers(&(file->text));
+    failed = ferror(file->fp);
+    if (fclose(file->fp) != 0 || failed)
+    {
+        return VTK_FILE_ERROR;
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief frees the dataset and the point and cell data of a vtk file
+ * @details Borrowed buffers are left alone, see the ownership flags. A 
+ * dataset shared with other files is left alone unless ownsDataset is set.
+ * The vtkDataFile structure itself is not freed.
+ * @param file the vtk file object
+ */
+int VTK_Free(vtkDataFile *file)
+{
+    int i;
+    vtkData *data[2];
+
+    if (file == NULL)
     {
-        for (i=0;i<(data->numScalars);i++)
+        return VTK_INVALID_USAGE_ERROR;
+    }
+
+    // a shared dataset is freed with the file that owns it
+    if (file->ownsDataset)
+    {
+        switch(file->geometry)
         {
-            int j;
-            scalar * sd;
-            sd = &(data->scalar_data[i]);
-            // print the header
-            switch (sd->type)
+            case VTK_UNSTRUCTURED_GRID:
             {
-                case VTK_INT:
+                unstructuredGrid *ug = (unstructuredGrid *)file->dataset;
+                if (ug != NULL)
                 {
-                    int * datai = (int *)(sd->data);
-                    fprintf(fp,"SCALARS %s int\nLOOKUP_TABLE default\n",sd->name);
-                    for (j=0;j<data->size;j++)
+                    if (ug->ownsPoints)
                     {
-                        fprintf(fp,"%d\n",datai[j]);
+                        free(ug->points);
                     }
-                }
-                    break;
-                case VTK_FLOAT:
-                {
-                    float * dataf = (float *)(sd->data);
-                    fprintf(fp,"SCALARS %s float\nLOOKUP_TABLE default\n",sd->name);
-                    for (j=0;j<data->size;j++)
+                    if (ug->ownsCells)
                     {
-                        fprintf(fp,"%f\n",dataf[j]);
+                        free(ug->cells);
                     }
+                    free(ug->numVerts);
+                    free(ug->cellTypes);
                 }
-                    break;                    
             }
-        }
-    }
-    else
-    {
-        for (i=0;i<(data->numScalars);i++)
-        {   
-            scalar * sd;
-            sd = &(data->scalar_data[i]);
-            size_t n;
-            switch (sd->type)
+                break;
+            case VTK_POLYDATA:
             {
-                case VTK_INT:
-                    fprintf(fp,"SCALARS %s int\nLOOKUP_TABLE default\n",sd->name);
-                    H2BE32(sd->data,data->size);
-                    n = fwrite(sd->data,sizeof(int),data->size,fp);
-                    BE2H32(sd->data,data->size);
-                    if (n != data->size)
+                polydata *pd = (polydata *)file->dataset;
+                if (pd != NULL)
+                {
+                    if (pd->ownsPoints)
                     {
-                        return VTK_FILE_ERROR;
+                        free(pd->points);
                     }
-                    break;
-                case VTK_FLOAT:
-                    fprintf(fp,"SCALARS %s float\nLOOKUP_TABLE default\n",sd->name);
-                    H2BE32(sd->data,data->size);
-                    n = fwrite(sd->data,sizeof(float),data->size,fp);
-                    BE2H32(sd->data,data->size);
-                    if (n != data->size)
+                    if (pd->ownsLines)
                     {
-                        return VTK_FILE_ERROR;
+                        free(pd->lines);
                     }
-                    break;
+                    if (pd->ownsPolygons)
+                    {
+                        free(pd->polygons);
+                    }
+                    free(pd->numLineVerts);
+                    free(pd->numVerts);
+                }
             }
-        }
-    }
-
-    if (type == VTK_ASCII)
-    {
-        // write vector data
-        for (i=0;i<(data->numVectors);i++)
-        {
-            int j;
-            vector *vd;
-            vd = &(data->vector_data[i]);
-            switch (vd->type)
+                break;
+            case VTK_RECTILINEAR_GRID:
             {
-                case VTK_INT:
+                rectilinearGrid *rg = (rectilinearGrid *)file->dataset;
+                if (rg != NULL)
                 {
-                    int * datai = (int *)(vd->data);
-                    fprintf(fp,"VECTORS %s int\n",vd->name);
-                    for (j=0;j<data->size;j++)
-                    {
-                        fprintf(fp,"%d %d %d\n",datai[j*3],datai[j*3+1],datai[j*3+2]);
-                    }
+                    free(rg->X_coordinates);
+                    free(rg->Y_coordinates);
+                    free(rg->Z_coordinates);
                 }
-                    break;
-                case VTK_FLOAT:
+            }
+                break;
+            case VTK_STRUCTURED_GRID:
+            {
+                structuredGrid *sg = (structuredGrid *)file->dataset;
+                if (sg != NULL && sg->ownsPoints)
                 {
-                    float * dataf = (float *)(vd->data);
-                    fprintf(fp,"VECTORS %s float\n",vd->name);
-                    for (j=0;j<data->size;j++)
-                    {
-                        fprintf(fp,"%f %f %f\n",dataf[j*3],dataf[j*3+1],dataf[j*3+2]);
-                    }
+                    free(sg->points);
                 }
-                    break;                    
             }
+                break;
         }
+        free(file->dataset);
     }
-    else 
+    file->dataset = NULL;
+
+    data[0] = file->pointdata;
+    data[1] = file->celldata;
+    for (i=0;i<2;i++)
     {
-         // write vector data
-        for (i=0;i<(data->numVectors);i++)
+        int j;
+        if (data[i] == NULL)
         {
-            vector *vd;
-            vd = &(data->vector_data[i]);
-            size_t n;
-            switch (vd->type)
+            continue;
+        }
+        for (j=0;j<data[i]->numScalars;j++)
+        {
+            if (data[i]->scalar_data[j].ownsData)
             {
-                case VTK_INT:
-                    fprintf(fp,"VECTORS %s int\n",vd->name);
-                    H2BE32(vd->data,data->size);
-                    n = fwrite((void*)vd->data,sizeof(int),data->size*VTK_DIM,fp);
-                    BE2H32(vd->data,data->size);
-                    if (n != data->size*VTK_DIM)
-                    {
-                        return VTK_FILE_ERROR;
-                    }
-                    break;
-                case VTK_FLOAT:
-                    fprintf(fp,"VECTORS %s float\n",vd->name);
-                    H2BE32(vd->data,data->size);
-                    n = fwrite((void*)vd->data,sizeof(float),data->size*VTK_DIM,fp);
-                    BE2H32(vd->data,data->size);
-                    if (n != data->size*VTK_DIM)
-                    {
-                        return VTK_FILE_ERROR;
-                    }
-                    break;                    
+                free(data[i]->scalar_data[j].data);
             }
         }
-       
+        for (j=0;j<data[i]->numVectors;j++)
+        {
+            if (data[i]->vector_data[j].ownsData)
+            {
+                free(data[i]->vector_data[j].data);
+            }
+        }
+        free(data[i]->scalar_data);
+        free(data[i]->vector_data);
+        free(data[i]);
     }
-
+    file->pointdata = NULL;
+    file->celldata = NULL;
     return VTK_SUCCESS;
-
-}
-/**
- * @brief closes the vtk file
- */
-int VTK_Close(vtkDataFile*file)
-{
-    fclose(file->fp);
 }
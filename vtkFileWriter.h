@@ -31,37 +31,40 @@
 #ifndef __VTKFILEWRITER_H
 #define __VTKFILEWRITER_H
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // copy_file_range()
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "byteSwap.h"
+#include "ioutils.h"
+#include "parallel.h"
 
 /*data types*/
 #define VTK_ASCII 0
 #define VTK_BINARY 1
+#define VTK_XML 2 // XML format with appended raw data, see vtkXMLWriter.h
 
-#define H2BE32(buf,size)                  \
-{                                         \
-    int iii;                              \
-    uint32_t * buf32;                     \
-    buf32 = (uint32_t *)(buf);            \
-    for(iii=0;iii<(size);iii++)           \
-    {                                     \
-        buf32[iii] = htobe32(buf32[iii]); \
-    }                                     \
-}                                         \
-
-#define BE2H32(buf,size)                  \
-{                                         \
-    int iii;                              \
-    uint32_t * buf32;                     \
-    buf32 = (uint32_t *)(buf);            \
-    for(iii=0;iii<(size);iii++)           \
-    {                                     \
-        buf32[iii] = be32toh(buf32[iii]); \
-    }                                     \
-}                                         \
+/* staging buffer for byte swapped binary output, small enough to stay in
+ * cache and to live on the stack of each writing thread*/
+#ifndef VTK_STAGING_BUFFER_SIZE
+#define VTK_STAGING_BUFFER_SIZE (64*1024)
+#endif
 
+/* buffer that ASCII output is formatted into before it is written*/
+#ifndef VTK_TEXT_BUFFER_SIZE
+#define VTK_TEXT_BUFFER_SIZE (1024*1024)
+#endif
+
+/* default bytes of a vtkSource read at a time, see vtkDataFile.memoryBudget*/
+#ifndef VTK_MEMORY_BUDGET_DEFAULT
+#define VTK_MEMORY_BUDGET_DEFAULT (64*1024*1024)
+#endif
 
 /*geometry*/
 #define VTK_STRUCTURED_POINTS 0
@@ -118,21 +121,47 @@
 typedef struct vtkDataFile_struct vtkDataFile;
 typedef struct unstructuredGrid_struct unstructuredGrid;
 typedef struct structuredPoints_struct structuredPoints;
+typedef struct structuredGrid_struct structuredGrid;
 typedef struct polydata_struct polydata;
+typedef struct rectilinearGrid_struct rectilinearGrid;
 typedef struct vtkData_struct vtkData;
 typedef struct scalar_struct scalar;
 typedef struct vector_struct vector;
+typedef struct vtkSource_struct vtkSource;
+typedef struct vtkTextBuffers_struct vtkTextBuffers;
+
+/* Ownership of array buffers: a buffer with its owns flag set is released by
+ * VTK_Free(), otherwise it is borrowed from the caller (e.g., a loaded DX 
+ * array) and must stay valid until the vtkDataFile is freed.*/
+
+/* values left in a file instead of memory, written by reading one window
+ * at a time. Big endian values are copied straight from the file to binary 
+ * output. The filename is borrowed like a data buffer. Values that are 
+ * computed instead (e.g., an implicit dx array) have an expand function, 
+ * which writes n values from value first in host order and returns 
+ * VTK_SUCCESS.*/
+struct vtkSource_struct {
+    const char *filename;
+    long offset; // byte offset of the first value
+    unsigned char bigEndian; // byte order of the values in the file
+    int (*expand)(const void *ctx, size_t first, size_t n, void *values);
+    const void *ctx; // passed to expand
+};
 
 struct scalar_struct {
     char name[32];
     int type;
     void * data;
+    unsigned char ownsData;
+    vtkSource source; // used if data is NULL
 };
 
 struct vector_struct {
     char name[32];
     int type;
     void *data;
+    unsigned char ownsData;
+    vtkSource source; // used if data is NULL
 };
 
 struct vtkData_struct {
@@ -150,6 +179,17 @@ struct vtkData_struct {
     vector *vector_data;
 };
 
+/* buffers of ASCII output, allocated by the first text written to a file
+ * and reused until it is closed, so streamed windows do not allocate*/
+struct vtkTextBuffers_struct {
+    int numThreads; // threads used to format large ASCII arrays
+    int maxRanges; // ranges formatted in each round
+    size_t *first; // first item of each range, maxRanges+1 entries
+    size_t *offset; // cells only, index in cells of the first vertex
+    size_t *lens; // bytes formatted into each buffer
+    char **bufs; // VTK_TEXT_BUFFER_SIZE buffer for each range, or NULL
+};
+
 struct vtkDataFile_struct {
     FILE *fp;
     char vtkVersion[4]; /*header version*/
@@ -157,8 +197,13 @@ struct vtkDataFile_struct {
     unsigned char dataType; 
     unsigned char geometry;
     void * dataset;
+    unsigned char ownsDataset; // zero if the dataset is shared with other files
     vtkData * pointdata;
     vtkData * celldata;
+    int numThreads; // threads used to format large ASCII arrays
+    size_t memoryBudget; // bytes of a vtkSource read at a time
+    unsigned char compressor; // XML output only, see vtkXMLWriter.h
+    vtkTextBuffers text; // set up by VTK_Open(), released by VTK_Close()
 };
 
 struct structuredPoints_struct {
@@ -171,16 +216,24 @@ struct structuredGrid_struct {
     int dimensions[VTK_DIM];
     int numPoints;
     float *points; // numpoints*3;
+    unsigned char ownsPoints; // zero if the points are borrowed
 };
 
 struct polydata_struct{
     int numPoints;
     float * points;
+    int numLines;
+    int *numLineVerts;
+    int *lines;
     int numPolygons;
     int *numVerts;
     int *polygons;
+    unsigned char ownsPoints;
+    unsigned char ownsLines;
+    unsigned char ownsPolygons;
 };
 
+/* the coordinates are always owned by the grid*/
 struct rectilinearGrid_struct{
     int dimensions[VTK_DIM];
     int numX;
@@ -200,14 +253,22 @@ struct unstructuredGrid_struct{
     int *cells;
     int *numVerts;
     int *cellTypes;
+    unsigned char ownsPoints;
+    unsigned char ownsCells;
 };
 
 /*function prototypes  */
 int VTK_Open(vtkDataFile *file, char * filename);
 int VTK_Write(vtkDataFile *file);
-int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug,char type);
-int VTK_WritePolydata(FILE *fp,polydata *pd,char type);
+int VTK_WriteUnstructuredGrid(FILE *fp,unstructuredGrid *ug,char type,vtkTextBuffers *text);
+int VTK_WritePolydata(FILE *fp,polydata *pd,char type,vtkTextBuffers *text);
 int VTK_WriteStructuredPoints(FILE *fp,structuredPoints *sp,char type);
-int VTK_WriteData(FILE *fp,vtkData *data,char type);
+int VTK_WriteRectilinearGrid(FILE *fp,rectilinearGrid *rg,char type,vtkTextBuffers *text);
+int VTK_WriteStructuredGrid(FILE *fp,structuredGrid *sg,char type,vtkTextBuffers *text);
+int VTK_WriteData(FILE *fp,vtkData *data,char type,vtkTextBuffers *text,size_t budget);
 int VTK_Close(vtkDataFile*file);
+int VTK_Free(vtkDataFile *file);
+int CopySource(FILE *fp, const vtkSource *source, size_t n);
+int ReadSource(int fd, const vtkSource *source, size_t first, size_t n, void *buf);
+int WriteSource(FILE *fp, const vtkSource *source, int type, size_t n, int perLine, char format, size_t budget, vtkTextBuffers *text);
 #endif
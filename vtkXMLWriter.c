@@ -0,0 +1,948 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vtkXMLWriter.h"
+
+typedef struct xmlArray_struct xmlArray;
+
+/* an array stored in the appended data section*/
+struct xmlArray_struct {
+    const char *name; // NULL for arrays without a name, e.g., points
+    const char *type; // XML type name, e.g., Float32
+    int numComponents;
+    int valueType; // VTK_INT or VTK_FLOAT, used to read a source
+    size_t numBytes;
+    const void *data; // values in host order, or NULL to read from source
+    const vtkSource *source;
+    void *owned; // buffer allocated by the writer, freed once written
+    long offsetPos; // file position of the offset attribute, if compressed
+};
+
+typedef struct blockJob_struct blockJob;
+
+/* blocks of one round of parallel compression*/
+struct blockJob_struct {
+    const unsigned char *raw; // uncompressed bytes of the round
+    size_t numBytes; // uncompressed bytes in the round
+    unsigned char *out; // one slot of bound bytes per block
+    size_t bound; // worst case compressed block size
+    uint64_t *sizes; // compressed size of each block
+    unsigned char compressor;
+    int rc; // VTK_SUCCESS unless a block failed
+};
+
+/**
+ * @brief gets the XML type name of a value type
+ * @param type VTK_INT or VTK_FLOAT
+ * @returns the type name, or NULL if the type is not supported
+ */
+static const char * GetXMLTypeName(int type)
+{
+    switch (type)
+    {
+        case VTK_INT:
+            return "Int32";
+        case VTK_FLOAT:
+            return "Float32";
+    }
+    return NULL;
+}
+
+/**
+ * @brief adds the scalars and vectors of a vtkData to the appended arrays
+ * @param arrays the appended arrays
+ * @param n the number of arrays already added
+ * @param data point or cell data
+ * @returns the number of arrays added so far
+ */
+static int AddDataArrays(xmlArray *arrays, int n, vtkData *data)
+{
+    int i;
+    if (data->size == 0)
+    {
+        return n;
+    }
+    for (i=0;i<(data->numScalars);i++)
+    {
+        scalar *sd;
+        sd = &(data->scalar_data[i]);
+        if (GetXMLTypeName(sd->type) == NULL)
+        {
+            continue;
+        }
+        arrays[n].name = sd->name;
+        arrays[n].type = GetXMLTypeName(sd->type);
+        arrays[n].numComponents = 1;
+        arrays[n].valueType = sd->type;
+        arrays[n].numBytes = (size_t)(data->size)*4;
+        arrays[n].data = sd->data;
+        arrays[n].source = &(sd->source);
+        arrays[n].owned = NULL;
+        n++;
+    }
+    for (i=0;i<(data->numVectors);i++)
+    {
+        vector *vd;
+        vd = &(data->vector_data[i]);
+        if (GetXMLTypeName(vd->type) == NULL)
+        {
+            continue;
+        }
+        arrays[n].name = vd->name;
+        arrays[n].type = GetXMLTypeName(vd->type);
+        arrays[n].numComponents = VTK_DIM;
+        arrays[n].valueType = vd->type;
+        arrays[n].numBytes = (size_t)(data->size)*VTK_DIM*4;
+        arrays[n].data = vd->data;
+        arrays[n].source = &(vd->source);
+        arrays[n].owned = NULL;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief adds the connectivity and offsets of cells to the appended arrays
+ * @details Cells are stored as their concatenated vertices and the end 
+ * offset of each cell, the offsets are built here and owned by the array.
+ * @param arrays the appended arrays
+ * @param n the number of arrays already added
+ * @param numVerts the vertex count of each cell
+ * @param cells the vertices of all cells, concatenated
+ * @param numCells the number of cells
+ * @returns the number of arrays added so far, or -1 if out of memory
+ */
+static int AddCellArrays(xmlArray *arrays, int n, const int *numVerts, const int *cells, int numCells)
+{
+    int i;
+    uint64_t offset;
+    int64_t *offsets;
+
+    offsets = (int64_t *)malloc((size_t)numCells*sizeof(int64_t));
+    if (offsets == NULL && numCells > 0)
+    {
+        return -1;
+    }
+    offset = 0;
+    for (i=0;i<numCells;i++)
+    {
+        offset += numVerts[i];
+        offsets[i] = offset;
+    }
+    arrays[n++] = (xmlArray){.name = "connectivity", .type = "Int32", .numComponents = 1, .valueType = VTK_INT, .numBytes = offset*4, .data = cells};
+    arrays[n++] = (xmlArray){.name = "offsets", .type = "Int64", .numComponents = 1, .valueType = VTK_INT, .numBytes = (size_t)numCells*sizeof(int64_t), .data = offsets, .owned = offsets};
+    return n;
+}
+
+/**
+ * @brief writes the DataArray elements of appended arrays
+ * @details Each array is stored as a UInt64 byte count followed by the
+ * values, so the offsets follow from the array sizes.
+ * Compressed sizes are not known yet, so the offsets of compressed arrays
+ * are left blank and filled in by WriteAppendedData().
+ * @param fp the output file stream
+ * @param arrays the appended arrays
+ * @param first the first array to write
+ * @param last one past the last array to write
+ * @param offset the offset of the first array in the appended data,
+ * updated to the offset after the last
+ * @param compressor the compressor, VTK_COMPRESSOR_NONE if not compressed
+ */
+static void WriteDataArrayElements(FILE *fp, xmlArray *arrays, int first, int last, uint64_t *offset, unsigned char compressor)
+{
+    int i;
+    for (i=first;i<last;i++)
+    {
+        fprintf(fp,"        <DataArray type=\"%s\"",arrays[i].type);
+        if (arrays[i].name != NULL)
+        {
+            fprintf(fp," Name=\"%s\"",arrays[i].name);
+        }
+        if (arrays[i].numComponents > 1)
+        {
+            fprintf(fp," NumberOfComponents=\"%d\"",arrays[i].numComponents);
+        }
+        if (compressor != VTK_COMPRESSOR_NONE)
+        {
+            fprintf(fp," format=\"appended\" offset=\"");
+            arrays[i].offsetPos = ftell(fp);
+            fprintf(fp,"%*s\"/>\n",VTK_XML_OFFSET_WIDTH,"");
+            continue;
+        }
+        fprintf(fp," format=\"appended\" offset=\"%llu\"/>\n",(unsigned long long)(*offset));
+        *offset += sizeof(uint64_t) + arrays[i].numBytes;
+    }
+}
+
+/**
+ * @brief writes a PointData or CellData element
+ * @details The first scalar and vector are marked as active, as they are
+ * in the legacy format.
+ * @param fp the output file stream
+ * @param tag PointData or CellData
+ * @param data the point or cell data
+ * @param arrays the appended arrays
+ * @param first the first array of this data
+ * @param last one past the last array of this data
+ * @param offset the offset of the first array in the appended data
+ * @param compressor the compressor, VTK_COMPRESSOR_NONE if not compressed
+ */
+static void WriteDataElement(FILE *fp, const char *tag, vtkData *data, xmlArray *arrays, int first, int last, uint64_t *offset, unsigned char compressor)
+{
+    fprintf(fp,"      <%s",tag);
+    if (data->size > 0 && data->numScalars > 0)
+    {
+        fprintf(fp," Scalars=\"%s\"",data->scalar_data[0].name);
+    }
+    if (data->size > 0 && data->numVectors > 0)
+    {
+        fprintf(fp," Vectors=\"%s\"",data->vector_data[0].name);
+    }
+    fprintf(fp,">\n");
+    WriteDataArrayElements(fp,arrays,first,last,offset,compressor);
+    fprintf(fp,"      </%s>\n",tag);
+}
+
+/**
+ * @brief gets the compressor class name written to the VTKFile element
+ */
+static const char * GetCompressorName(unsigned char compressor)
+{
+    switch (compressor)
+    {
+        case VTK_COMPRESSOR_ZLIB:
+            return "vtkZLibDataCompressor";
+        case VTK_COMPRESSOR_LZ4:
+            return "vtkLZ4DataCompressor";
+    }
+    return NULL;
+}
+
+/**
+ * @brief gets the worst case compressed size of a block
+ */
+static size_t GetCompressBound(unsigned char compressor, size_t n)
+{
+    switch (compressor)
+    {
+#ifdef VTK_HAVE_LZ4
+        case VTK_COMPRESSOR_LZ4:
+            return LZ4_compressBound(n);
+#endif
+        default:
+            return compressBound(n);
+    }
+}
+
+/**
+ * @brief compresses block b of a round, run by ParallelFor
+ */
+static void CompressBlockTask(void *ctx, size_t b)
+{
+    blockJob *job;
+    const unsigned char *src;
+    unsigned char *dst;
+    size_t n;
+
+    job = (blockJob *)ctx;
+    src = job->raw + b*VTK_XML_BLOCK_SIZE;
+    dst = job->out + b*job->bound;
+    n = job->numBytes - b*VTK_XML_BLOCK_SIZE;
+    if (n > VTK_XML_BLOCK_SIZE)
+    {
+        n = VTK_XML_BLOCK_SIZE;
+    }
+
+    switch (job->compressor)
+    {
+        case VTK_COMPRESSOR_ZLIB:
+        {
+            uLongf len = job->bound;
+            if (compress2(dst,&len,src,n,VTK_XML_ZLIB_LEVEL) == Z_OK)
+            {
+                job->sizes[b] = len;
+                return;
+            }
+        }
+            break;
+#ifdef VTK_HAVE_LZ4
+        case VTK_COMPRESSOR_LZ4:
+        {
+            int len = LZ4_compress_default((const char *)src,(char *)dst,n,job->bound);
+            if (len > 0)
+            {
+                job->sizes[b] = len;
+                return;
+            }
+        }
+            break;
+#endif
+    }
+    __sync_bool_compare_and_swap(&(job->rc),VTK_SUCCESS,VTK_NOT_SUPPORTED_ERROR);
+}
+
+/**
+ * @brief compresses the blocks of an array and writes them in order
+ * @details Each round compresses VTK_XML_BLOCKS_PER_ROUND blocks in 
+ * parallel and writes them before the next round is started. A source is
+ * read one round at a time, so memory use does not depend on the size of
+ * the array.
+ * @param fp the output file stream
+ * @param a the array
+ * @param job the compression job, with out and bound set
+ * @param numBlocks the number of blocks
+ * @param sizes output compressed size of each block
+ * @param window buffer of one round of blocks, used to read a source
+ * @param fd the open source file, if the array has no data
+ * @param numThreads the maximum number of threads to use
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+static int WriteCompressedBlocks(FILE *fp, xmlArray *a, blockJob *job, size_t numBlocks, uint64_t *sizes, unsigned char *window, int fd, int numThreads)
+{
+    size_t b;
+    size_t k;
+    size_t m;
+    int rc;
+
+    for (b=0;b<numBlocks;b+=m)
+    {
+        m = (numBlocks - b < VTK_XML_BLOCKS_PER_ROUND) ? numBlocks - b : VTK_XML_BLOCKS_PER_ROUND;
+        job->numBytes = a->numBytes - b*VTK_XML_BLOCK_SIZE;
+        if (job->numBytes > m*VTK_XML_BLOCK_SIZE)
+        {
+            job->numBytes = m*VTK_XML_BLOCK_SIZE;
+        }
+        if (a->data == NULL)
+        {
+            rc = ReadSource(fd,a->source,b*VTK_XML_BLOCK_SIZE/4,job->numBytes/4,window);
+            if (rc != VTK_SUCCESS)
+            {
+                return rc;
+            }
+            job->raw = window;
+        }
+        else
+        {
+            job->raw = (const unsigned char *)(a->data) + b*VTK_XML_BLOCK_SIZE;
+        }
+        job->sizes = sizes + b;
+        ParallelFor(numThreads,m,CompressBlockTask,job);
+        if (job->rc != VTK_SUCCESS)
+        {
+            return job->rc;
+        }
+        for (k=0;k<m;k++)
+        {
+            if (fwrite(job->out + k*job->bound,1,job->sizes[k],fp) != job->sizes[k])
+            {
+                return VTK_FILE_ERROR;
+            }
+        }
+    }
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief writes an array in the vtk compressed block format
+ * @details The array is split into VTK_XML_BLOCK_SIZE blocks, which follow
+ * a header of the block count, the block sizes and the compressed size of
+ * each block. The header is written again once the blocks are written and
+ * their sizes are known.
+ * @param fp the output file stream, must be seekable
+ * @param a the array
+ * @param compressor the compressor
+ * @param numThreads the maximum number of threads to use
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+static int WriteCompressedArray(FILE *fp, xmlArray *a, unsigned char compressor, int numThreads)
+{
+    size_t numBlocks;
+    long headerPos;
+    int fromSource;
+    int fd;
+    int rc;
+    uint64_t *header;
+    unsigned char *window;
+    blockJob job;
+
+    numBlocks = (a->numBytes + VTK_XML_BLOCK_SIZE - 1)/VTK_XML_BLOCK_SIZE;
+    header = (uint64_t *)calloc(3 + numBlocks,sizeof(uint64_t));
+    job.compressor = compressor;
+    job.rc = VTK_SUCCESS;
+    job.bound = GetCompressBound(compressor,VTK_XML_BLOCK_SIZE);
+    job.out = (unsigned char *)malloc(VTK_XML_BLOCKS_PER_ROUND*job.bound);
+    window = NULL;
+    fd = -1;
+    // an empty array has nothing to read
+    fromSource = (a->data == NULL && a->numBytes > 0);
+    if (fromSource)
+    {
+        window = (unsigned char *)malloc(VTK_XML_BLOCKS_PER_ROUND*VTK_XML_BLOCK_SIZE);
+        if (a->source->expand == NULL)
+        {
+            fd = open(a->source->filename,O_RDONLY);
+        }
+    }
+
+    if (header == NULL || job.out == NULL || (fromSource && window == NULL))
+    {
+        rc = VTK_MEMORY_ERROR;
+    }
+    else if (fromSource && a->source->expand == NULL && fd < 0)
+    {
+        rc = VTK_FILE_NOT_FOUND_ERROR;
+    }
+    else
+    {
+        header[0] = numBlocks;
+        header[1] = VTK_XML_BLOCK_SIZE;
+        header[2] = a->numBytes % VTK_XML_BLOCK_SIZE;
+        headerPos = ftell(fp);
+        rc = VTK_FILE_ERROR;
+        if (fwrite(header,sizeof(uint64_t),3 + numBlocks,fp) == 3 + numBlocks)
+        {
+            rc = WriteCompressedBlocks(fp,a,&job,numBlocks,header + 3,window,fd,numThreads);
+        }
+        if (rc == VTK_SUCCESS)
+        {
+            if (fseek(fp,headerPos,SEEK_SET) != 0
+                || fwrite(header,sizeof(uint64_t),3 + numBlocks,fp) != 3 + numBlocks
+                || fseek(fp,0,SEEK_END) != 0)
+            {
+                rc = VTK_FILE_ERROR;
+            }
+        }
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    free(window);
+    free(job.out);
+    free(header);
+    return rc;
+}
+
+/**
+ * @brief writes the appended data section and closes the VTKFile element
+ * @param fp the output file stream
+ * @param arrays the appended arrays, in the order of their offsets
+ * @param n the number of arrays
+ * @param budget the maximum number of bytes read at a time from a source
+ * @param compressor the compressor, VTK_COMPRESSOR_NONE if not compressed
+ * @param numThreads the maximum number of threads used to compress
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+static int WriteAppendedData(FILE *fp, xmlArray *arrays, int n, size_t budget, unsigned char compressor, int numThreads)
+{
+    int i;
+    int rc;
+    long start;
+    uint64_t numBytes;
+
+    fprintf(fp,"  <AppendedData encoding=\"raw\">\n   _");
+    start = ftell(fp);
+    for (i=0;i<n && compressor != VTK_COMPRESSOR_NONE;i++)
+    {
+        long pos;
+        pos = ftell(fp);
+        rc = WriteCompressedArray(fp,arrays + i,compressor,numThreads);
+        if (rc != VTK_SUCCESS)
+        {
+            return rc;
+        }
+        // fill in the offset left blank in the header
+        if (fseek(fp,arrays[i].offsetPos,SEEK_SET) != 0)
+        {
+            return VTK_FILE_ERROR;
+        }
+        fprintf(fp,"%-*llu",VTK_XML_OFFSET_WIDTH,(unsigned long long)(pos - start));
+        if (fseek(fp,0,SEEK_END) != 0)
+        {
+            return VTK_FILE_ERROR;
+        }
+    }
+    for (i=0;i<n && compressor == VTK_COMPRESSOR_NONE;i++)
+    {
+        numBytes = arrays[i].numBytes;
+        if (fwrite(&numBytes,sizeof(uint64_t),1,fp) != 1)
+        {
+            return VTK_FILE_ERROR;
+        }
+        if (arrays[i].numBytes == 0)
+        {
+            continue;
+        }
+        if (arrays[i].data == NULL)
+        {
+            rc = WriteSource(fp,arrays[i].source,arrays[i].valueType,arrays[i].numBytes/4,1,VTK_XML,budget,NULL);
+            if (rc != VTK_SUCCESS)
+            {
+                return rc;
+            }
+        }
+        else if (fwrite(arrays[i].data,1,arrays[i].numBytes,fp) != arrays[i].numBytes)
+        {
+            return VTK_FILE_ERROR;
+        }
+    }
+    fprintf(fp,"\n  </AppendedData>\n</VTKFile>\n");
+    return VTK_SUCCESS;
+}
+
+/**
+ * @brief writes the XML declaration and opens the VTKFile element
+ * @param fp the output file stream
+ * @param type the dataset type, e.g., UnstructuredGrid
+ * @param compressor the compressor, VTK_COMPRESSOR_NONE if not compressed
+ */
+static void WriteXMLHeader(FILE *fp, const char *type, unsigned char compressor)
+{
+    fprintf(fp,"<?xml version=\"1.0\"?>\n");
+    fprintf(fp,"<VTKFile type=\"%s\" version=\"%s\" byte_order=\"%s\" header_type=\"UInt64\"",type,VTK_XML_VERSION,VTK_XML_BYTE_ORDER);
+    if (compressor != VTK_COMPRESSOR_NONE)
+    {
+        fprintf(fp," compressor=\"%s\"",GetCompressorName(compressor));
+    }
+    fprintf(fp,">\n");
+}
+
+/**
+ * @brief writes a list of floats as an attribute value
+ */
+static void WriteFloatList(FILE *fp, const float *values, int n)
+{
+    char buf[FORMAT_FLOAT_MAX_LENGTH + 1];
+    int i;
+    int len;
+    for (i=0;i<n;i++)
+    {
+        len = FormatFloat(values[i],buf);
+        if (i < n-1)
+        {
+            buf[len++] = ' ';
+        }
+        fwrite(buf,1,len,fp);
+    }
+}
+
+/**
+ * @brief Writes a vtk data file in XML format
+ * @details Unstructured grids are written as .vtu files, poly data as 
+ * .vtp files, structured points as .vti files, rectilinear grids as .vtr files and structured 
+ * grids as .vts files, the caller chooses the file name. Compressed files
+ * are patched as they are written, so the file must be seekable.
+ * @param file the vtkDataFile, opened with VTK_Open()
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXML(vtkDataFile *file)
+{
+    switch(file->geometry)
+    {
+        case VTK_UNSTRUCTURED_GRID:
+            return VTK_WriteXMLUnstructuredGrid(file);
+        case VTK_POLYDATA:
+            return VTK_WriteXMLPolyData(file);
+        case VTK_STRUCTURED_POINTS:
+            return VTK_WriteXMLImageData(file);
+        case VTK_RECTILINEAR_GRID:
+            return VTK_WriteXMLRectilinearGrid(file);
+        case VTK_STRUCTURED_GRID:
+            return VTK_WriteXMLStructuredGrid(file);
+    }
+    return VTK_NOT_SUPPORTED_ERROR;
+}
+
+/**
+ * @brief Writes an unstructured grid as an XML UnstructuredGrid file
+ * @details Points, connectivity and point and cell data are written from
+ * their buffers as they are. Only the cell offsets and the one byte cell
+ * types are built by the writer.
+ * @param file the vtkDataFile, with an unstructured grid dataset
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXMLUnstructuredGrid(vtkDataFile *file)
+{
+    int i;
+    int n;
+    int numPointArrays;
+    int numCellArrays;
+    int rc;
+    uint64_t offset;
+    uint8_t *types;
+    xmlArray *arrays;
+    unstructuredGrid *ug;
+    FILE *fp;
+
+    fp = file->fp;
+    ug = (unstructuredGrid *)file->dataset;
+
+    arrays = (xmlArray *)malloc((file->pointdata->numScalars + file->pointdata->numVectors
+        + file->celldata->numScalars + file->celldata->numVectors + 4)*sizeof(xmlArray));
+    types = (uint8_t *)malloc((size_t)(ug->numCells)*sizeof(uint8_t));
+    if (arrays == NULL || types == NULL)
+    {
+        free(arrays);
+        free(types);
+        return VTK_MEMORY_ERROR;
+    }
+
+    // cells are stored as connectivity, the end offset of each cell and types
+    for (i=0;i<(ug->numCells);i++)
+    {
+        types[i] = (uint8_t)(ug->cellTypes[i]);
+    }
+
+    n = AddDataArrays(arrays,0,file->pointdata);
+    numPointArrays = n;
+    n = AddDataArrays(arrays,n,file->celldata);
+    numCellArrays = n - numPointArrays;
+    arrays[n++] = (xmlArray){.type = "Float32", .numComponents = VTK_DIM, .valueType = VTK_FLOAT, .numBytes = (size_t)(ug->numPoints)*VTK_DIM*4, .data = ug->points};
+    if ((rc = AddCellArrays(arrays,n,ug->numVerts,ug->cells,ug->numCells)) < 0)
+    {
+        free(arrays);
+        free(types);
+        return VTK_MEMORY_ERROR;
+    }
+    n = rc;
+    arrays[n++] = (xmlArray){.name = "types", .type = "UInt8", .numComponents = 1, .valueType = VTK_INT, .numBytes = (size_t)(ug->numCells), .data = types, .owned = types};
+
+    WriteXMLHeader(fp,"UnstructuredGrid",file->compressor);
+    fprintf(fp,"  <UnstructuredGrid>\n");
+    fprintf(fp,"    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n",ug->numPoints,ug->numCells);
+    offset = 0;
+    WriteDataElement(fp,"PointData",file->pointdata,arrays,0,numPointArrays,&offset,file->compressor);
+    WriteDataElement(fp,"CellData",file->celldata,arrays,numPointArrays,numPointArrays + numCellArrays,&offset,file->compressor);
+    fprintf(fp,"      <Points>\n");
+    WriteDataArrayElements(fp,arrays,n-4,n-3,&offset,file->compressor);
+    fprintf(fp,"      </Points>\n");
+    fprintf(fp,"      <Cells>\n");
+    WriteDataArrayElements(fp,arrays,n-3,n,&offset,file->compressor);
+    fprintf(fp,"      </Cells>\n");
+    fprintf(fp,"    </Piece>\n");
+    fprintf(fp,"  </UnstructuredGrid>\n");
+
+    rc = WriteAppendedData(fp,arrays,n,file->memoryBudget,file->compressor,file->numThreads);
+
+    for (i=0;i<n;i++)
+    {
+        free(arrays[i].owned);
+    }
+    free(arrays);
+    return rc;
+}
+
+/**
+ * @brief Writes poly data as an XML PolyData file
+ * @details Points and cell vertices are written from their buffers as 
+ * they are, only the cell offsets are built by the writer. Cell data of
+ * lines come before that of polygons, as in the legacy format.
+ * @param file the vtkDataFile, with a polydata dataset
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXMLPolyData(vtkDataFile *file)
+{
+    int i;
+    int n;
+    int m;
+    int polys;
+    int numPointArrays;
+    int numCellArrays;
+    int rc;
+    uint64_t offset;
+    xmlArray *arrays;
+    polydata *pd;
+    FILE *fp;
+
+    fp = file->fp;
+    pd = (polydata *)file->dataset;
+
+    arrays = (xmlArray *)malloc((file->pointdata->numScalars + file->pointdata->numVectors
+        + file->celldata->numScalars + file->celldata->numVectors + 5)*sizeof(xmlArray));
+    if (arrays == NULL)
+    {
+        return VTK_MEMORY_ERROR;
+    }
+    n = AddDataArrays(arrays,0,file->pointdata);
+    numPointArrays = n;
+    n = AddDataArrays(arrays,n,file->celldata);
+    numCellArrays = n - numPointArrays;
+    arrays[n] = (xmlArray){.type = "Float32", .numComponents = VTK_DIM, .valueType = VTK_FLOAT, .numBytes = (size_t)(pd->numPoints)*VTK_DIM*4, .data = pd->points};
+    // lines then polygons, each as connectivity and offsets, if there are any
+    m = n + 1;
+    if (pd->numLines > 0)
+    {
+        m = AddCellArrays(arrays,m,pd->numLineVerts,pd->lines,pd->numLines);
+    }
+    polys = m;
+    if (pd->numPolygons > 0 && m >= 0)
+    {
+        m = AddCellArrays(arrays,m,pd->numVerts,pd->polygons,pd->numPolygons);
+    }
+    if (m < 0)
+    {
+        if (polys > n + 1)
+        {
+            free(arrays[n+2].owned);
+        }
+        free(arrays);
+        return VTK_MEMORY_ERROR;
+    }
+
+    WriteXMLHeader(fp,"PolyData",file->compressor);
+    fprintf(fp,"  <PolyData>\n");
+    fprintf(fp,"    <Piece NumberOfPoints=\"%d\" NumberOfVerts=\"0\" NumberOfLines=\"%d\" NumberOfStrips=\"0\" NumberOfPolys=\"%d\">\n",
+            pd->numPoints,pd->numLines,pd->numPolygons);
+    offset = 0;
+    WriteDataElement(fp,"PointData",file->pointdata,arrays,0,numPointArrays,&offset,file->compressor);
+    WriteDataElement(fp,"CellData",file->celldata,arrays,numPointArrays,numPointArrays + numCellArrays,&offset,file->compressor);
+    fprintf(fp,"      <Points>\n");
+    WriteDataArrayElements(fp,arrays,n,n+1,&offset,file->compressor);
+    fprintf(fp,"      </Points>\n");
+    if (polys > n + 1)
+    {
+        fprintf(fp,"      <Lines>\n");
+        WriteDataArrayElements(fp,arrays,n+1,polys,&offset,file->compressor);
+        fprintf(fp,"      </Lines>\n");
+    }
+    if (m > polys)
+    {
+        fprintf(fp,"      <Polys>\n");
+        WriteDataArrayElements(fp,arrays,polys,m,&offset,file->compressor);
+        fprintf(fp,"      </Polys>\n");
+    }
+    fprintf(fp,"    </Piece>\n");
+    fprintf(fp,"  </PolyData>\n");
+    n = m;
+
+    rc = WriteAppendedData(fp,arrays,n,file->memoryBudget,file->compressor,file->numThreads);
+
+    for (i=0;i<n;i++)
+    {
+        free(arrays[i].owned);
+    }
+    free(arrays);
+    return rc;
+}
+
+/**
+ * @brief Writes structured points as an XML ImageData file
+ * @param file the vtkDataFile, with a structured points dataset
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXMLImageData(vtkDataFile *file)
+{
+    int i;
+    int n;
+    int numPointArrays;
+    int rc;
+    uint64_t offset;
+    char extent[64];
+    xmlArray *arrays;
+    structuredPoints *sp;
+    FILE *fp;
+
+    fp = file->fp;
+    sp = (structuredPoints *)file->dataset;
+
+    arrays = (xmlArray *)malloc((file->pointdata->numScalars + file->pointdata->numVectors
+        + file->celldata->numScalars + file->celldata->numVectors + 1)*sizeof(xmlArray));
+    if (arrays == NULL)
+    {
+        return VTK_MEMORY_ERROR;
+    }
+    n = AddDataArrays(arrays,0,file->pointdata);
+    numPointArrays = n;
+    n = AddDataArrays(arrays,n,file->celldata);
+
+    snprintf(extent,sizeof(extent),"0 %d 0 %d 0 %d",sp->dimensions[0]-1,sp->dimensions[1]-1,sp->dimensions[2]-1);
+    WriteXMLHeader(fp,"ImageData",file->compressor);
+    fprintf(fp,"  <ImageData WholeExtent=\"%s\" Origin=\"",extent);
+    WriteFloatList(fp,sp->origin,VTK_DIM);
+    fprintf(fp,"\" Spacing=\"");
+    WriteFloatList(fp,sp->spacing,VTK_DIM);
+    fprintf(fp,"\">\n");
+    fprintf(fp,"    <Piece Extent=\"%s\">\n",extent);
+    offset = 0;
+    WriteDataElement(fp,"PointData",file->pointdata,arrays,0,numPointArrays,&offset,file->compressor);
+    WriteDataElement(fp,"CellData",file->celldata,arrays,numPointArrays,n,&offset,file->compressor);
+    fprintf(fp,"    </Piece>\n");
+    fprintf(fp,"  </ImageData>\n");
+
+    rc = WriteAppendedData(fp,arrays,n,file->memoryBudget,file->compressor,file->numThreads);
+
+    for (i=0;i<n;i++)
+    {
+        free(arrays[i].owned);
+    }
+    free(arrays);
+    return rc;
+}
+
+/**
+ * @brief Writes a rectilinear grid as an XML RectilinearGrid file
+ * @param file the vtkDataFile, with a rectilinear grid dataset
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXMLRectilinearGrid(vtkDataFile *file)
+{
+    int i;
+    int n;
+    int numPointArrays;
+    int rc;
+    uint64_t offset;
+    char extent[64];
+    xmlArray *arrays;
+    rectilinearGrid *rg;
+    FILE *fp;
+
+    fp = file->fp;
+    rg = (rectilinearGrid *)file->dataset;
+
+    arrays = (xmlArray *)malloc((file->pointdata->numScalars + file->pointdata->numVectors
+        + file->celldata->numScalars + file->celldata->numVectors + VTK_DIM)*sizeof(xmlArray));
+    if (arrays == NULL)
+    {
+        return VTK_MEMORY_ERROR;
+    }
+    n = AddDataArrays(arrays,0,file->pointdata);
+    numPointArrays = n;
+    n = AddDataArrays(arrays,n,file->celldata);
+    arrays[n++] = (xmlArray){.name = "x_coordinates", .type = "Float32", .numComponents = 1, .valueType = VTK_FLOAT, .numBytes = (size_t)(rg->numX)*4, .data = rg->X_coordinates};
+    arrays[n++] = (xmlArray){.name = "y_coordinates", .type = "Float32", .numComponents = 1, .valueType = VTK_FLOAT, .numBytes = (size_t)(rg->numY)*4, .data = rg->Y_coordinates};
+    arrays[n++] = (xmlArray){.name = "z_coordinates", .type = "Float32", .numComponents = 1, .valueType = VTK_FLOAT, .numBytes = (size_t)(rg->numZ)*4, .data = rg->Z_coordinates};
+
+    snprintf(extent,sizeof(extent),"0 %d 0 %d 0 %d",rg->dimensions[0]-1,rg->dimensions[1]-1,rg->dimensions[2]-1);
+    WriteXMLHeader(fp,"RectilinearGrid",file->compressor);
+    fprintf(fp,"  <RectilinearGrid WholeExtent=\"%s\">\n",extent);
+    fprintf(fp,"    <Piece Extent=\"%s\">\n",extent);
+    offset = 0;
+    WriteDataElement(fp,"PointData",file->pointdata,arrays,0,numPointArrays,&offset,file->compressor);
+    WriteDataElement(fp,"CellData",file->celldata,arrays,numPointArrays,n-VTK_DIM,&offset,file->compressor);
+    fprintf(fp,"      <Coordinates>\n");
+    WriteDataArrayElements(fp,arrays,n-VTK_DIM,n,&offset,file->compressor);
+    fprintf(fp,"      </Coordinates>\n");
+    fprintf(fp,"    </Piece>\n");
+    fprintf(fp,"  </RectilinearGrid>\n");
+
+    rc = WriteAppendedData(fp,arrays,n,file->memoryBudget,file->compressor,file->numThreads);
+
+    for (i=0;i<n;i++)
+    {
+        free(arrays[i].owned);
+    }
+    free(arrays);
+    return rc;
+}
+
+/**
+ * @brief Writes a structured grid as an XML StructuredGrid file
+ * @details The points are written from their buffer as they are, the 
+ * cells follow from the extent.
+ * @param file the vtkDataFile, with a structured grid dataset
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteXMLStructuredGrid(vtkDataFile *file)
+{
+    int i;
+    int n;
+    int numPointArrays;
+    int rc;
+    uint64_t offset;
+    char extent[64];
+    xmlArray *arrays;
+    structuredGrid *sg;
+    FILE *fp;
+
+    fp = file->fp;
+    sg = (structuredGrid *)file->dataset;
+
+    arrays = (xmlArray *)malloc((file->pointdata->numScalars + file->pointdata->numVectors
+        + file->celldata->numScalars + file->celldata->numVectors + 1)*sizeof(xmlArray));
+    if (arrays == NULL)
+    {
+        return VTK_MEMORY_ERROR;
+    }
+    n = AddDataArrays(arrays,0,file->pointdata);
+    numPointArrays = n;
+    n = AddDataArrays(arrays,n,file->celldata);
+    arrays[n++] = (xmlArray){.type = "Float32", .numComponents = VTK_DIM, .valueType = VTK_FLOAT, .numBytes = (size_t)(sg->numPoints)*VTK_DIM*4, .data = sg->points};
+
+    snprintf(extent,sizeof(extent),"0 %d 0 %d 0 %d",sg->dimensions[0]-1,sg->dimensions[1]-1,sg->dimensions[2]-1);
+    WriteXMLHeader(fp,"StructuredGrid",file->compressor);
+    fprintf(fp,"  <StructuredGrid WholeExtent=\"%s\">\n",extent);
+    fprintf(fp,"    <Piece Extent=\"%s\">\n",extent);
+    offset = 0;
+    WriteDataElement(fp,"PointData",file->pointdata,arrays,0,numPointArrays,&offset,file->compressor);
+    WriteDataElement(fp,"CellData",file->celldata,arrays,numPointArrays,n-1,&offset,file->compressor);
+    fprintf(fp,"      <Points>\n");
+    WriteDataArrayElements(fp,arrays,n-1,n,&offset,file->compressor);
+    fprintf(fp,"      </Points>\n");
+    fprintf(fp,"    </Piece>\n");
+    fprintf(fp,"  </StructuredGrid>\n");
+
+    rc = WriteAppendedData(fp,arrays,n,file->memoryBudget,file->compressor,file->numThreads);
+
+    for (i=0;i<n;i++)
+    {
+        free(arrays[i].owned);
+    }
+    free(arrays);
+    return rc;
+}
+
+/**
+ * @brief Writes a ParaView collection (.pvd) of a time series
+ * @details Each file is listed with its time step, so the series can be
+ * opened from one index file. Paths are written as given, relative paths
+ * are relative to the directory of the collection file.
+ * @param filename the collection file name
+ * @param files the dataset file of each time step
+ * @param timesteps the time of each step
+ * @param n the number of time steps
+ * @returns VTK_SUCCESS or an appropriate error code
+ */
+int VTK_WriteCollection(const char *filename, char **files, const float *timesteps, int n)
+{
+    FILE *fp;
+    char buf[FORMAT_FLOAT_MAX_LENGTH + 1];
+    int i;
+    int len;
+
+    fp = fopen(filename,"w");
+    if (fp == NULL)
+    {
+        return VTK_FILE_ERROR;
+    }
+    fprintf(fp,"<?xml version=\"1.0\"?>\n");
+    fprintf(fp,"<VTKFile type=\"Collection\" version=\"0.1\" byte_order=\"%s\">\n",VTK_XML_BYTE_ORDER);
+    fprintf(fp,"  <Collection>\n");
+    for (i=0;i<n;i++)
+    {
+        len = FormatFloat(timesteps[i],buf);
+        buf[len] = '\0';
+        fprintf(fp,"    <DataSet timestep=\"%s\" group=\"\" part=\"0\" file=\"%s\"/>\n",buf,files[i]);
+    }
+    fprintf(fp,"  </Collection>\n");
+    fprintf(fp,"</VTKFile>\n");
+    if (fclose(fp) != 0)
+    {
+        return VTK_FILE_ERROR;
+    }
+    return VTK_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/* dx2vtk: OpenDX to VTK file format converter
+ * Copyright (C) 2015  David J. Warne
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file vtkXMLWriter.h
+ * @brief Writes a vtk data file using the XML format
+ *
+ * @details Writes the same vtkDataFile model as the legacy writer, as an
+ * UnstructuredGrid (.vtu), PolyData (.vtp), ImageData (.vti), 
+ * RectilinearGrid (.vtr) or StructuredGrid (.vts) file. All arrays are stored
+ * in the appended data section with raw encoding in host byte order, so
+ * in memory arrays are written without conversion. Arrays may also be 
+ * compressed with zlib (or LZ4 if built with VTK_HAVE_LZ4), in blocks that
+ * are compressed in parallel. A time series is indexed by a ParaView
+ * collection (.pvd) file.
+ *
+ * @author David J. Warne (david.warne@qut.edu.au)
+ * @author High Performance Computing and Research Support
+ * @author Queensland University of Technology
+ *
+ */
+
+#ifndef __VTKXMLWRITER_H
+#define __VTKXMLWRITER_H
+
+#include <zlib.h>
+#ifdef VTK_HAVE_LZ4
+#include <lz4.h>
+#endif
+#include "vtkFileWriter.h"
+
+#define VTK_XML_VERSION "1.0"
+
+/*compressors*/
+#define VTK_COMPRESSOR_NONE 0
+#define VTK_COMPRESSOR_ZLIB 1
+#define VTK_COMPRESSOR_LZ4 2
+
+/* uncompressed bytes per compressed block, the vtk default*/
+#ifndef VTK_XML_BLOCK_SIZE
+#define VTK_XML_BLOCK_SIZE 32768
+#endif
+
+/* blocks compressed in parallel before they are written*/
+#ifndef VTK_XML_BLOCKS_PER_ROUND
+#define VTK_XML_BLOCKS_PER_ROUND 64
+#endif
+
+/* zlib level, floating point data gains little from the slower levels*/
+#ifndef VTK_XML_ZLIB_LEVEL
+#define VTK_XML_ZLIB_LEVEL 1
+#endif
+
+/* characters reserved for an offset that is patched once it is known*/
+#define VTK_XML_OFFSET_WIDTH 20
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define VTK_XML_BYTE_ORDER "LittleEndian"
+#else
+#define VTK_XML_BYTE_ORDER "BigEndian"
+#endif
+
+/*function prototypes  */
+int VTK_WriteXML(vtkDataFile *file);
+int VTK_WriteXMLUnstructuredGrid(vtkDataFile *file);
+int VTK_WriteXMLPolyData(vtkDataFile *file);
+int VTK_WriteXMLImageData(vtkDataFile *file);
+int VTK_WriteXMLRectilinearGrid(vtkDataFile *file);
+int VTK_WriteXMLStructuredGrid(vtkDataFile *file);
+int VTK_WriteCollection(const char *filename, char **files, const float *timesteps, int n);
+#endif